@@ -49,11 +49,15 @@
 #define configUSE_PREEMPTION			1
 #define configUSE_IDLE_HOOK				1
 #define configUSE_TICK_HOOK				1
+#ifdef SHELL_QEMU
+#define configCPU_CLOCK_HZ				( 168000000 )	/* netduinoplus2 SYSCLK, fixed in QEMU */
+#else
 #define configCPU_CLOCK_HZ				( 84000000 )
+#endif
 #define configTICK_RATE_HZ				( ( TickType_t ) 1000 )
 #define configMAX_PRIORITIES			( 5 )
 #define configMINIMAL_STACK_SIZE		( ( unsigned short ) 130 )
-#define configTOTAL_HEAP_SIZE			( ( size_t ) ( 8 * 1024 ) )
+#define configTOTAL_HEAP_SIZE			( ( size_t ) ( 12 * 1024 ) )
 #define configMAX_TASK_NAME_LEN			( 10 )
 #define configUSE_TRACE_FACILITY		1
 #define configUSE_16_BIT_TICKS			0
@@ -66,6 +70,13 @@
 #define configUSE_APPLICATION_TASK_TAG	0
 #define configUSE_COUNTING_SEMAPHORES	1
 #define configGENERATE_RUN_TIME_STATS	0
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS	1
+
+/* Context switch count, read by the shell's time command. */
+#ifndef __ASSEMBLER__
+	extern volatile uint32_t ulContextSwitchCount;
+#endif
+#define traceTASK_SWITCHED_IN()			( ulContextSwitchCount++ )
 
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES 		0
@@ -0,0 +1,46 @@
+#ifndef DWT_H
+#define DWT_H
+
+#include "main.h"
+#include <stdint.h>
+
+// Cortex-M4 DWT cycle counter helpers used for on-target profiling
+
+static inline void DWT_Init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// Start the counter if nobody has yet, without resetting it under other users
+static inline void DWT_Enable(void) {
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+}
+
+#ifdef SHELL_QEMU
+/* QEMU has no DWT model and CYCCNT reads 0. Count SysTick instead: HAL
+ * ticks times the reload, plus how far the current reload has counted
+ * down. Differences are emulated time in SYSCLK cycles, not instructions,
+ * and can be a tick short when read with the tick interrupt pending.
+ */
+static inline uint32_t DWT_GetCycles(void) {
+    uint32_t load = SysTick->LOAD + 1u;
+    uint32_t ms;
+    uint32_t val;
+
+    do {
+        ms = HAL_GetTick();
+        val = SysTick->VAL;
+    } while (ms != HAL_GetTick());
+    return ms * load + (load - 1u - val);
+}
+#else
+static inline uint32_t DWT_GetCycles(void) {
+    return DWT->CYCCNT;
+}
+#endif
+
+#endif /* DWT_H */
@@ -0,0 +1,29 @@
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+/* Streaming printf engine.
+ *
+ * Formats straight into a sink in FMT_CHUNK_SIZE pieces instead of rendering
+ * the whole message into a stack buffer first, so output is never truncated
+ * and literal text is handed to the sink without being copied.
+ *
+ * Supports the usual %d %i %u %x %X %o %c %s %p %% with flags '-' '+' ' ' '#'
+ * '0', width, precision and the h/hh/l/ll/z/j/t length modifiers, plus:
+ *   %b    unsigned binary, e.g. "%032lb" for a full register
+ *   '     group digits: hex/binary in fours with '_', decimal in threes
+ *         with ',' ("%'08lX" -> "A800_04A0"). Zero padding counts digits
+ *         only, separators are added on top.
+ * Floating point is not supported.
+ */
+
+#define FMT_CHUNK_SIZE 32
+
+typedef void (*fmt_write_fn)(void *ctx, const char *data, size_t len);
+
+int fmt_vprintf(fmt_write_fn write, void *ctx, const char *format, va_list args);
+int fmt_printf(fmt_write_fn write, void *ctx, const char *format, ...);
+
+#endif /* FMT_H */
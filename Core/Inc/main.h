@@ -45,6 +45,8 @@ void Error_Handler(void);
 
 #define USART_TX_Pin GPIO_PIN_2
 #define USART_RX_Pin GPIO_PIN_3
+#define USART_CTS_Pin GPIO_PIN_0
+#define USART_RTS_Pin GPIO_PIN_1
 
 
 #ifdef __cplusplus
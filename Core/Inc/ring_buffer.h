@@ -0,0 +1,51 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Lock-free single-producer / single-consumer byte ring.
+ *
+ * head is only written by the producer and tail only by the consumer, both
+ * run freely and wrap at 2^32, so head - tail is always the fill level and
+ * no shared counter is needed. The producer may be an ISR and the consumer
+ * a task (or the other way round) without critical sections. Capacity must
+ * be a power of two.
+ */
+typedef struct {
+    uint8_t *buffer;
+    uint32_t mask;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+} RingBuffer_t;
+
+#define RING_IS_POW2(n) (((n) != 0) && (((n) & ((n) - 1)) == 0))
+
+void ring_init(RingBuffer_t *rb, uint8_t *storage, uint32_t capacity);
+void ring_reset(RingBuffer_t *rb);
+
+static inline uint32_t ring_capacity(const RingBuffer_t *rb) {
+    return rb->mask + 1;
+}
+
+static inline uint32_t ring_count(const RingBuffer_t *rb) {
+    return rb->head - rb->tail;
+}
+
+static inline uint32_t ring_space(const RingBuffer_t *rb) {
+    return ring_capacity(rb) - ring_count(rb);
+}
+
+// Producer side
+int ring_putc(RingBuffer_t *rb, uint8_t c);
+uint32_t ring_write(RingBuffer_t *rb, const uint8_t *data, uint32_t len);
+uint32_t ring_write_span(RingBuffer_t *rb, uint8_t **span);
+void ring_produce(RingBuffer_t *rb, uint32_t len);
+
+// Consumer side
+int ring_getc(RingBuffer_t *rb);
+uint32_t ring_read(RingBuffer_t *rb, uint8_t *dst, uint32_t len);
+uint32_t ring_peek_span(const RingBuffer_t *rb, const uint8_t **span);
+void ring_commit(RingBuffer_t *rb, uint32_t len);
+
+#endif /* RING_BUFFER_H */
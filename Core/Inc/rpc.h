@@ -0,0 +1,76 @@
+#ifndef RPC_H
+#define RPC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Binary RPC transport sharing USART2 with the text shell.
+ *
+ * Sending RPC_MAGIC in text mode switches the session to RPC mode; the
+ * device answers with an RPC_OP_HELLO frame. RPC_OP_EXIT switches back.
+ * Wait for HELLO before sending requests. With XON/XOFF flow control the
+ * driver neither acts on nor sends 0x11/0x13 in RPC mode, since frames carry
+ * them as data.
+ *
+ * Frames are COBS encoded and terminated by 0x00. Decoded frame layout:
+ *   request:  [seq][op][payload ...][crc32]
+ *   response: [seq][op | 0x80][status][payload ...][crc32]
+ * crc32 is little-endian and computed by the STM32 CRC unit: CRC-32/MPEG-2
+ * (poly 0x04C11DB7, init 0xFFFFFFFF, no reflection, no final XOR) over the
+ * frame bytes before the CRC, zero padded to a multiple of 4 and fed as
+ * little-endian 32-bit words.
+ *
+ * Requests (all integers little-endian); a payload longer than
+ * RPC_MAX_PAYLOAD is answered with RPC_STATUS_BAD_ARG:
+ *   PING     any payload, echoed back
+ *   EXEC     command line text; output is returned in RPC_STATUS_MORE frames
+ *            followed by a final RPC_STATUS_OK frame
+ *   READ32   [addr:4][count:1]   -> count words (addr 4-byte aligned)
+ *   WRITE32  [addr:4][value:4]
+ *   READMEM  [addr:4][len:2]     -> len bytes, split over RPC_STATUS_MORE
+ *                                   frames of at most RPC_MAX_PAYLOAD bytes
+ *   STATS    -> RpcStats_t
+ *   EXIT     back to text mode
+ */
+
+#define RPC_MAGIC           "\x16\x16\x02"     // SYN SYN STX
+#define RPC_MAX_PAYLOAD     240
+#define RPC_VERSION         1
+
+#define RPC_OP_HELLO        0x00
+#define RPC_OP_PING         0x01
+#define RPC_OP_EXEC         0x02
+#define RPC_OP_READ32       0x03
+#define RPC_OP_WRITE32      0x04
+#define RPC_OP_READMEM      0x05
+#define RPC_OP_STATS        0x06
+#define RPC_OP_EXIT         0x7F
+#define RPC_OP_RESPONSE     0x80
+
+#define RPC_STATUS_OK       0x00
+#define RPC_STATUS_MORE     0x01
+#define RPC_STATUS_BAD_CRC  0x02
+#define RPC_STATUS_BAD_OP   0x03
+#define RPC_STATUS_BAD_ARG  0x04
+#define RPC_STATUS_BAD_ADDR 0x05
+
+typedef struct {
+    uint32_t frames_rx;
+    uint32_t frames_tx;
+    uint32_t bytes_rx;
+    uint32_t bytes_tx;
+    uint32_t crc_errors;
+    uint32_t framing_errors;
+} RpcStats_t;
+
+int rpc_active(void);
+int rpc_detect_magic(uint8_t c);
+void rpc_enter(void);
+void rpc_input(uint8_t c);
+const RpcStats_t* rpc_get_stats(void);
+
+size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst);
+int cobs_decode(const uint8_t *src, size_t len, uint8_t *dst);
+uint32_t rpc_crc32(const uint8_t *data, size_t len);
+
+#endif /* RPC_H */
@@ -2,63 +2,75 @@
 #define SHELL_H
 
 #include "main.h"
+#include "ring_buffer.h"
+#include "fmt.h"
+#include "shell_args.h"
+#include "shell_history.h"
 #include <stdint.h>
 #include <stddef.h>
 
 // Constants
 #define CMD_BUFFER_SIZE 124
-#define PRINT_BUFFER_SIZE 256
-#define RX_BUFFER_SIZE 256
-#define CMD_HISTORY_SIZE 10
+#define RX_BUFFER_SIZE 1024
+#define SHELL_PROMPT "STM32> "
+#define SHELL_DEFAULT_WIDTH 80      // until the terminal reports its own
+#define SHELL_MIN_WIDTH 20
 
-// Data structures
-typedef struct {
-    uint8_t buffer[RX_BUFFER_SIZE];
-    int head;
-    int tail;
-    int count;
-} RingBuffer_t;
-
-typedef struct {
-    char commands[CMD_HISTORY_SIZE][CMD_BUFFER_SIZE];
-    int current_index;
-    int display_index;
-    int history_count;
-} CommandHistory_t;
+// Baud negotiation
+#define BAUD_PROBE_PATTERN "\r\nUUUUUUUU baud probe, reply ok\r\n"
+#define BAUD_PROBE_TIMEOUT_MS 2000
+#define BAUD_MAX_ERROR_PPM 25000
 
 // Global variables (extern declarations)
 extern char cmd_buffer[CMD_BUFFER_SIZE];
-extern int cursor_pos;
 extern RingBuffer_t rx_buffer;
 extern CommandHistory_t cmd_history_buffer;
 
 // Core shell functions
-void buffer_putc(RingBuffer_t *rb, uint8_t c);
-uint8_t buffer_getc(RingBuffer_t *rb);
 void save_cmd_to_history(CommandHistory_t *history, char *cmd);
 void show_previous_cmd(CommandHistory_t *history);
 void show_next_cmd(CommandHistory_t *history);
 void print_shell(const char *format, ...);
+void shell_set_output(fmt_write_fn write, void *ctx);
+void shell_get_output(fmt_write_fn *write, void **ctx);
 void uint32_to_binary_string(uint32_t num, char *buffer, size_t buffer_size);
 void shell_prompt(void);
 void shell_init(void);
+uint16_t shell_term_width(void);
+int shell_wait_input(uint32_t timeout_ms);
+void shell_wake(void);
+void shell_poll(void);
 
 // Input processing functions
 void process_char(const uint8_t c);
-void process_input(void);
+uint32_t process_input(void);
 void process_command(char *command);
 
-// Command implementations
+/* Replaying input (shell_bench.c): begin sets the line being edited, the
+ * key decoder, Ctrl+R search and history aside and starts them empty, so
+ * process_char() can be fed from inside a command; end puts them back.
+ */
+void shell_replay_begin(void);
+void shell_replay_end(void);
+
+// Command implementations, registered with SHELL_COMMAND (shell_cmd.h)
 void print_help_msg(void);
 void print_sys_info_msg(void);
 void clear_cmd(void);
-void echo_cmd(char *cmd);
+void echo_cmd(int argc, ShellArg_t *argv);
+void status_cmd(int argc, ShellArg_t *argv);
+void led_cmd(int argc, ShellArg_t *argv);
+void showreg_cmd(int argc, ShellArg_t *argv);
+void rx_profile_cmd(int argc, ShellArg_t *argv);
+void fmt_bench_cmd(int argc, ShellArg_t *argv);
+void baud_cmd(int argc, ShellArg_t *argv);
+void flow_cmd(int argc, ShellArg_t *argv);
 
 // GPIO status functions
 void print_gpio_status_cmd(GPIO_TypeDef *GPIOx, const char *port_name);
 
 // UART status functions
-void print_uart_status_cmd(char *args);
+void print_uart_status_cmd(USART_TypeDef *usart);
 void showreg_uart(USART_TypeDef *UARTx);
 
 // RCC status functions
@@ -66,7 +78,7 @@ void print_rcc_status_cmd(void);
 void showreg_rcc(void);
 
 // Timer status functions
-void print_timer_status_cmd(char *args);
+void print_timer_status_cmd(TIM_TypeDef *tim);
 void showreg_timer1(void);
 
 // GPIO register functions
@@ -0,0 +1,89 @@
+#ifndef SHELL_ARGS_H
+#define SHELL_ARGS_H
+
+#include "main.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/* Command line tokenizer and typed argument parsing.
+ *
+ * shell_tokenize() splits a line in place: blanks separate words, "..." and
+ * '...' group them, and a backslash takes the next character literally
+ * (except inside '...'). argv entries point into the line itself. starts,
+ * if not NULL, receives where each word began in the line as typed, so a
+ * caller that kept a copy can recover the raw text (quotes and all).
+ *
+ * Each registered command carries an argument spec (shell_cmd.h) that is
+ * both its usage text and its parser. Elements are separated by blanks,
+ * <...> is required and [...] is optional:
+ *   <on|off|toggle>   one of the listed words (case-insensitive), as index
+ *   [reset]           a single literal word
+ *   <periph>          a peripheral name from shell_periphs[]
+ *   [reg]             a register of the peripheral given just before it
+ *   <rate:int>        an unsigned integer, see shell_parse_u32()
+ *   <name:str>        any word
+ *   [text...]         the remaining words (must be last)
+ * An optional word that does not match is skipped when more elements follow
+ * ("[-v] <pattern:str>"); its argv slot is kept with str NULL, so handlers
+ * can always index arguments by their position in the spec.
+ * shell_args_bind() applies the spec and reports problems in one format, so
+ * handlers only ever see arguments that passed it. Given rawv (each token's
+ * text as typed, through the end of the line) it also fills in raw, which
+ * shell_args_rest() uses to hand the rest of a line to another command.
+ */
+
+#define SHELL_MAX_ARGS 8
+
+// shell_tokenize() errors
+#define SHELL_TOK_ERR_QUOTE  (-1)
+#define SHELL_TOK_ERR_COUNT  (-2)
+
+typedef enum {
+    PERIPH_GPIO,
+    PERIPH_USART,
+    PERIPH_RCC,
+    PERIPH_TIM
+} ShellPeriphKind_t;
+
+typedef struct {
+    const char *name;           // lower case, as typed
+    uint16_t offset;            // from the peripheral base
+} ShellReg_t;
+
+/* Name tables (shell_periphs[] and the register tables) are kept sorted by
+ * name: lookups binary search them and tab completion walks them as a trie.
+ */
+typedef struct {
+    const char *name;           // lower case, as typed
+    const char *label;          // upper case, for output
+    ShellPeriphKind_t kind;
+    void *base;
+    const ShellReg_t *regs;
+    uint8_t reg_count;
+} ShellPeriph_t;
+
+typedef struct {
+    const char *str;            // token as typed, NULL for an absent optional
+    const char *raw;            // token and the rest of the line before unquoting, NULL if unknown
+    uint32_t num;               // :int
+    int index;                  // word lists: position in the list
+    const ShellPeriph_t *periph;
+    const ShellReg_t *reg;
+} ShellArg_t;
+
+extern const ShellPeriph_t shell_periphs[];
+extern const size_t shell_periph_count;
+
+int shell_tokenize(char *line, char **argv, uint16_t *starts, int max_args);
+// argv has SHELL_MAX_ARGS entries; binding that needs more (skipped optionals count) is a usage error
+int shell_args_bind(const char *cmd, const char *spec, int tokc, char **tokv, const char *const *rawv,
+                    ShellArg_t *argv);
+int shell_args_rest(int argc, ShellArg_t *argv, int first, char *out, size_t size);
+
+int shell_parse_u32(const char *s, uint32_t *out);
+int shell_parse_word(const char *s, const char *words, size_t words_len);
+const ShellPeriph_t* shell_parse_periph(const char *s);
+const ShellReg_t* shell_parse_reg(const ShellPeriph_t *periph, const char *s);
+const char* shell_spec_element(const char *spec, int index, size_t *len);
+
+#endif /* SHELL_ARGS_H */
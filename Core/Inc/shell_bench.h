@@ -0,0 +1,43 @@
+#ifndef SHELL_BENCH_H
+#define SHELL_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* keybench [runs]
+ *
+ * Replays keystroke streams through process_char() as if they had come in
+ * over the UART: typing and running commands, walking the history with the
+ * arrow keys and Ctrl+R, pasting into the middle of a line, escape sequence
+ * storms, Tab completion and Ctrl+C. Every run starts from an empty editor
+ * and history (shell_replay_begin()), and the output is counted instead of
+ * sent, so the figures are what decoding, editing, echoing and dispatching
+ * cost without the UART driver:
+ *
+ *   cyc/B   DWT cycles per input byte (the host build scales CLOCK_MONOTONIC)
+ *   out/in  bytes the shell sends back per input byte
+ *   wire    time those bytes take on the line at the current baud rate
+ *
+ * At 115200 baud a byte takes 87 us on the wire, so out/in is usually the
+ * limit on how fast keys can be handled, long before the CPU is.
+ *
+ * Cycles are elapsed cycles, like time's: interrupts and the RX task are in
+ * them if they ran.
+ */
+
+#define SHELL_BENCH_RUNS    10
+
+typedef struct {
+    uint32_t runs;
+    uint32_t in_bytes;          // totals over all runs
+    uint32_t out_bytes;
+    uint64_t cycles;
+} ShellBenchResult_t;
+
+// One run of data (Enter is '\n') on an empty editor whose history holds the given entries, oldest first
+void shell_bench_replay(const uint8_t *data, size_t len, const char *const *history, ShellBenchResult_t *r);
+
+void shell_bench_header(uint32_t runs);
+void shell_bench_print(const char *name, const ShellBenchResult_t *r);
+
+#endif /* SHELL_BENCH_H */
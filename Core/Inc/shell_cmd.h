@@ -0,0 +1,43 @@
+#ifndef SHELL_CMD_H
+#define SHELL_CMD_H
+
+#include <stddef.h>
+#include "shell_args.h"
+
+/* Shell command registry.
+ *
+ * Each module declares its commands with SHELL_COMMAND() next to the
+ * handler. The entries land in .shell_cmd.<name> input sections, which
+ * STM32F401XX_FLASH.ld collects with SORT_BY_NAME into one flash table
+ * between __shell_cmd_start and __shell_cmd_end. The table is therefore
+ * sorted by command name and lookup is a binary search, whatever the
+ * number of commands or the order of the object files.
+ *
+ * Command names must be lower-case C identifiers and unique; lookup
+ * ignores the case of what was typed, as completion does. The argument spec
+ * (see shell_args.h) is both the usage text and the parser: handlers are
+ * only called with arguments that match it. argv[0] is the command name.
+ */
+
+typedef void (*shell_handler_fn)(int argc, ShellArg_t *argv);
+
+typedef struct {
+    const char *name;
+    shell_handler_fn handler;
+    const char *args;           // argument spec, e.g. "<on|off|toggle>"
+    const char *help;
+} ShellCommand_t;
+
+#define SHELL_COMMAND(cmd_name, fn, arg_spec, help_text)                        \
+    static const ShellCommand_t shell_cmd_##cmd_name                            \
+    __attribute__((used, section(".shell_cmd." #cmd_name), aligned(4))) = {    \
+        #cmd_name, fn, arg_spec, help_text                                      \
+    }
+
+const ShellCommand_t* shell_cmd_find(const char *name, size_t len);
+const ShellCommand_t* shell_cmd_begin(void);
+const ShellCommand_t* shell_cmd_end(void);
+size_t shell_cmd_count(void);
+int shell_cmd_verify(void);
+
+#endif /* SHELL_CMD_H */
@@ -0,0 +1,39 @@
+#ifndef SHELL_COMPLETE_H
+#define SHELL_COMPLETE_H
+
+#include <stddef.h>
+
+/* Tab completion for command names, peripherals and registers.
+ *
+ * The candidate sets are the flash tables that already exist: the command
+ * registry and shell_periphs[] / register tables, all sorted by name, so
+ * the names sharing a prefix form one contiguous range. On its first Tab a
+ * table gets a radix trie over those ranges, built into a fixed pool of
+ * 5-byte nodes; edge labels are read from the names in flash. Looking up
+ * a prefix then costs one compare per character along an edge and a scan
+ * of at most one sibling list per branch, O(prefix length) with no
+ * allocation. A table that does not fit the pool is searched by binary
+ * narrowing at each depth, O(prefix length * log n), instead.
+ */
+
+#define SHELL_TRIE_NODES  160   // 800 bytes; the commands, peripherals and register tables take 107
+#define SHELL_TRIE_TABLES 8     // distinct tables: commands, peripherals, one per register layout
+
+// Any table of structs whose first member is the const char *name
+typedef struct {
+    const void *base;
+    size_t stride;
+    size_t count;
+} ShellNameTable_t;
+
+const char* shell_name_at(const ShellNameTable_t *table, size_t index);
+size_t shell_complete_range(const ShellNameTable_t *table, const char *prefix, size_t len, size_t *first);
+
+/* Complete the word ending at line[len]. Writes up to size characters to
+ * add there into out: the common prefix of all candidates, plus a blank if
+ * there is only one. Returns their number, or -1 after listing the
+ * candidates when list is set and nothing could be added.
+ */
+int shell_complete(const char *line, int len, char *out, int size, int list);
+
+#endif /* SHELL_COMPLETE_H */
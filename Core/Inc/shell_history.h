@@ -0,0 +1,53 @@
+#ifndef SHELL_HISTORY_H
+#define SHELL_HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Command history packed into a fixed byte arena.
+ *
+ * Entries are stored back to back as [len][text][len], with a length byte on
+ * both ends so the ring can be walked in either direction without an index
+ * table. head and tail run freely like the RingBuffer_t indices; adding an
+ * entry evicts the oldest ones until it fits. A 10 character command costs
+ * 12 bytes instead of a whole CMD_BUFFER_SIZE slot, and repeating the newest
+ * entry does not store it again.
+ *
+ * Positions (uint32_t) are arena offsets of an entry's start; head is the
+ * start of the line being edited, which is not stored.
+ */
+
+#define HISTORY_ARENA_SIZE 1024     // power of two
+#define HISTORY_MAX_ENTRY  255      // longest command the length bytes can describe
+
+typedef struct {
+    uint8_t arena[HISTORY_ARENA_SIZE];
+    uint32_t head;                  // end of the newest entry
+    uint32_t tail;                  // start of the oldest entry
+    uint32_t cursor;                // entry shown by Up/Down, head when none
+    uint32_t count;                 // entries stored
+    uint32_t total;                 // entries ever added, numbers the `history` listing
+} CommandHistory_t;
+
+void shell_history_add(CommandHistory_t *history, const char *cmd, size_t len);
+void shell_history_clear(CommandHistory_t *history);
+
+// Up/Down: copy the older/newer entry into out, -1 at the end (next returns 0 back at the new line)
+int shell_history_prev(CommandHistory_t *history, char *out, size_t size);
+int shell_history_next(CommandHistory_t *history, char *out, size_t size);
+
+static inline void shell_history_rewind(CommandHistory_t *history) {
+    history->cursor = history->head;
+}
+
+// Walking entries by position, oldest first: for (p = tail; p != head; p = shell_history_newer(h, p))
+uint32_t shell_history_newer(const CommandHistory_t *history, uint32_t pos);
+size_t shell_history_read(const CommandHistory_t *history, uint32_t pos, char *out, size_t size);
+
+/* Reverse search: from the entry before *pos back to the oldest, find the
+ * newest one containing pattern. On a match *pos is set to it and 1 returned.
+ * Start with *pos = head; an empty pattern matches any entry.
+ */
+int shell_history_search(const CommandHistory_t *history, uint32_t *pos, const char *pattern, size_t len);
+
+#endif /* SHELL_HISTORY_H */
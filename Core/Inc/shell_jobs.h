@@ -0,0 +1,54 @@
+#ifndef SHELL_JOBS_H
+#define SHELL_JOBS_H
+
+#include <stdint.h>
+#include "fmt.h"
+#include "shell_pipe.h"
+
+/* Background jobs and cancellation.
+ *
+ * "cmd &" hands the command to one of SHELL_JOB_WORKERS worker tasks,
+ * created at start-up below the shell's priority, and the prompt comes back
+ * at once. Each task that runs commands has its own ShellContext_t (found
+ * through FreeRTOS thread-local storage; the shell task uses the foreground
+ * one), so output redirection and pipelines in a job do not leak into the
+ * foreground and the other way round. Job output goes straight to the UART.
+ *
+ * Cancellation is cooperative: Ctrl+C is spotted by UARTRxTask as soon as
+ * it arrives, before the shell task reads it, and sets the foreground
+ * context's cancel flag; kill sets a job's. Long-running commands poll
+ * shell_cancelled() and return early. The flag is cleared only where a
+ * top-level command starts (Enter, a job, a watch frame, RPC EXEC), never
+ * for commands nested in time, watch or keybench, so the Ctrl+C reaches
+ * the outer one.
+ *
+ * The workers' stacks come out of configTOTAL_HEAP_SIZE at start-up: with
+ * both at 2 KB the tasks, timers and semaphores take about 10 KB of the
+ * 12 KB heap.
+ */
+
+#define SHELL_JOB_WORKERS     2
+#define SHELL_JOB_STACK_WORDS 512       // as the shell task: a job runs anything the prompt can
+#define SHELL_JOB_PRIORITY    1         // below the shell task, so input stays responsive
+#define SHELL_TLS_CONTEXT     0         // thread-local storage slot of the context pointer
+
+typedef struct {
+    fmt_write_fn out;                   // NULL: the UART
+    void *out_ctx;
+    volatile uint8_t cancel;
+    uint8_t piping;                     // pipe is in use; a nested command (time "a | b") cannot have one
+    ShellPipe_t pipe;
+} ShellContext_t;
+
+ShellContext_t* shell_context(void);
+int shell_cancelled(void);
+int shell_in_background(void);
+
+// RX path: the user pressed Ctrl+C
+void shell_interrupt(void);
+
+void shell_jobs_init(void);
+int shell_job_start(const char *command);
+int shell_jobs_poll(void);
+
+#endif /* SHELL_JOBS_H */
@@ -0,0 +1,31 @@
+#ifndef SHELL_LINE_H
+#define SHELL_LINE_H
+
+/* Line editor for the shell prompt.
+ *
+ * Keeps the text and cursor of the line being typed and mirrors every edit
+ * on the terminal with as few bytes as possible: short cursor moves are sent
+ * as backspaces or by re-sending the characters stepped over, longer ones as
+ * CSI n D / CSI n C, deletions as DCH (CSI n P) or erase-to-EOL (CSI K), and
+ * replacing the whole line (history recall) only re-sends what differs from
+ * the text already on screen.
+ */
+
+typedef struct {
+    char *buf;
+    int size;                   // of buf, including room for the NUL
+    int len;
+    int cursor;
+} ShellLine_t;
+
+void shell_line_reset(ShellLine_t *line);
+void shell_line_insert(ShellLine_t *line, const char *s, int n);
+void shell_line_delete(ShellLine_t *line, int from, int to);
+void shell_line_move(ShellLine_t *line, int pos);
+void shell_line_replace(ShellLine_t *line, const char *s, int n);
+
+// Word boundaries left and right of the cursor; words are separated by blanks
+int shell_line_word_left(const ShellLine_t *line);
+int shell_line_word_right(const ShellLine_t *line);
+
+#endif /* SHELL_LINE_H */
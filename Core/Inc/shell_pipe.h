@@ -0,0 +1,76 @@
+#ifndef SHELL_PIPE_H
+#define SHELL_PIPE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "fmt.h"
+#include "ring_buffer.h"
+#include "shell_args.h"
+
+/* Output pipelines: cmd | filter | filter ...
+ *
+ * Each filter stage is an fmt_write_fn sink. It cuts the bytes written to
+ * it into lines in a small buffer, hands every complete line to the filter,
+ * and the filter writes what it keeps to the next stage, the last one to
+ * the shell's real output. Nothing holds more than one line, except tail,
+ * which keeps its last lines in a byte ring. Lines longer than
+ * SHELL_PIPE_LINE_SIZE are cut.
+ *
+ * Filters (arguments bound like command specs, see shell_args.h):
+ *   grep [-v] <pattern>     lines containing pattern (case-insensitive)
+ *   head [-n] [lines]       the first lines (default 10)
+ *   tail [-n] [lines]       the last lines (default 10, one tail per pipeline)
+ *   count                   number of lines
+ *   hex2bin                 rewrite 0x numbers as grouped binary
+ */
+
+#define SHELL_PIPE_MAX_FILTERS 3
+#define SHELL_PIPE_LINE_SIZE   128
+#define SHELL_PIPE_TAIL_SIZE   512     // power of two
+#define SHELL_PIPE_DEFAULT_LINES 10
+
+typedef struct ShellFilter_s ShellFilter_t;
+
+typedef struct {
+    const ShellFilter_t *filter;
+    fmt_write_fn next;
+    void *next_ctx;
+    uint16_t len;
+    char line[SHELL_PIPE_LINE_SIZE];
+    union {
+        struct {
+            const char *pattern;
+            size_t pattern_len;
+            uint8_t invert;
+        } grep;
+        struct {
+            uint32_t limit;
+            uint32_t lines;
+            RingBuffer_t *ring;
+        } lines;
+    } u;
+} ShellPipeStage_t;
+
+typedef struct {
+    ShellPipeStage_t stages[SHELL_PIPE_MAX_FILTERS];
+    int count;
+    fmt_write_fn saved;
+    void *saved_ctx;
+    RingBuffer_t tail;
+    uint8_t tail_storage[SHELL_PIPE_TAIL_SIZE];
+} ShellPipe_t;
+
+// Split line in place at each unquoted '|'; returns the number of segments or -1 if more than max
+int shell_pipe_split(char *line, char **segments, int max);
+
+/* Bind the filter segments and route print_shell through them. Errors are
+ * reported on the current output and leave it untouched (-1).
+ */
+int shell_pipe_open(ShellPipe_t *pipe, int count, char **segments);
+
+// Flush partial lines and the filters' end output, then restore the output
+void shell_pipe_close(ShellPipe_t *pipe);
+
+void shell_pipe_list_filters(void);
+
+#endif /* SHELL_PIPE_H */
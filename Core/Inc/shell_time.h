@@ -0,0 +1,38 @@
+#ifndef SHELL_TIME_H
+#define SHELL_TIME_H
+
+#include <stdint.h>
+
+/* time <command...>
+ *
+ * Runs a command and reports what it cost: DWT CYCCNT cycles and the wall
+ * time they amount to, the part of it spent waiting for room in the UART TX
+ * queue, context switches (counted by traceTASK_SWITCHED_IN) and the deepest
+ * stack the command reached. For the stack, the free part of the calling
+ * task's stack is painted with the FreeRTOS fill pattern before the call and
+ * scanned for the lowest overwritten word afterwards.
+ *
+ * Cycles are elapsed cycles: when the switch count is not zero they include
+ * time other tasks and interrupts ran, as the wall time does.
+ */
+
+#define SHELL_TIME_FILL         0xA5A5A5A5u     // tskSTACK_FILL_BYTE, so overflow checking still agrees
+#define SHELL_TIME_PAINT_MARGIN 16              // words left unpainted below the painter's own frame
+
+typedef struct {
+    uint32_t cycles;
+    uint32_t ticks;
+    uint32_t tx_blocked_cycles;
+    uint32_t switches;
+    uint32_t stack_used;        // bytes below the caller's frame the command reached
+    uint32_t stack_free;        // bytes never touched below that
+
+    // Reference points, set by shell_time_start()
+    uint32_t *stack_base;
+    uint32_t *stack_top;
+} ShellTime_t;
+
+void shell_time_start(ShellTime_t *t);
+void shell_time_stop(ShellTime_t *t);
+
+#endif /* SHELL_TIME_H */
@@ -0,0 +1,66 @@
+#ifndef SHELL_VT_H
+#define SHELL_VT_H
+
+#include <stdint.h>
+
+/* VT100/ANSI input decoder.
+ *
+ * A table-driven DFA in the style of the DEC parser diagrams: every byte is
+ * mapped to a class, and (state, class) indexes one table entry holding the
+ * action and the next state, so each byte costs two lookups. It understands
+ * plain characters and C0 controls, ESC x (Meta keys), CSI with numeric
+ * parameters, private markers and intermediates (ESC [ 3 ~, ESC [ 1 ; 5 D,
+ * ESC [ 24 ; 80 R) and SS3 (ESC O H), and turns complete sequences into key
+ * events. Unknown or malformed sequences are swallowed whole instead of
+ * leaking their tail into the line.
+ */
+
+#define VT_MAX_PARAMS 4
+
+typedef enum {
+    VT_KEY_NONE,
+    VT_KEY_CHAR,                // printable character in ch
+    VT_KEY_CTRL,                // C0 control or DEL in ch
+    VT_KEY_META,                // ESC followed by ch (Alt+ch)
+    VT_KEY_UP,
+    VT_KEY_DOWN,
+    VT_KEY_RIGHT,
+    VT_KEY_LEFT,
+    VT_KEY_HOME,
+    VT_KEY_END,
+    VT_KEY_INSERT,
+    VT_KEY_DELETE,
+    VT_KEY_PAGE_UP,
+    VT_KEY_PAGE_DOWN,
+    VT_KEY_CURSOR_REPORT        // reply to CSI 6 n, in row/col
+} VtKey_t;
+
+// Modifier bits, from the second CSI parameter (ESC [ 1 ; 5 D is Ctrl+Left)
+#define VT_MOD_SHIFT 0x01
+#define VT_MOD_ALT   0x02
+#define VT_MOD_CTRL  0x04
+
+typedef struct {
+    VtKey_t key;
+    uint8_t mods;
+    char ch;
+    uint16_t row;
+    uint16_t col;
+} VtEvent_t;
+
+typedef struct {
+    uint8_t state;
+    uint8_t nparams;
+    uint8_t marker;             // private marker or intermediate byte, 0 if none
+    uint16_t params[VT_MAX_PARAMS];
+} VtParser_t;
+
+// Ask the terminal for its width: park the cursor far right, request its position, restore it
+#define VT_QUERY_WIDTH "\0337\033[999C\033[6n\0338"
+
+void shell_vt_init(VtParser_t *vt);
+
+// Feed one input byte; returns 1 and fills ev when it completes a key
+int shell_vt_feed(VtParser_t *vt, uint8_t c, VtEvent_t *ev);
+
+#endif /* SHELL_VT_H */
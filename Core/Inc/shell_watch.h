@@ -0,0 +1,26 @@
+#ifndef SHELL_WATCH_H
+#define SHELL_WATCH_H
+
+#include <stdint.h>
+
+/* watch [-n] <ms> <command...>
+ *
+ * A FreeRTOS software timer marks the command due and wakes the shell task,
+ * which re-runs it from shell_poll() with print_shell pointed at a screen
+ * model of the last frame (WATCH_ROWS x WATCH_COLS). Each character is
+ * compared with what is already on the terminal as it is produced: only
+ * changed cells are sent, after a cursor address when the terminal cursor
+ * is not already there, and lines or rows that got shorter are erased with
+ * CSI K. An unchanged frame costs nothing on the wire. Ctrl+C stops it.
+ */
+
+#define WATCH_ROWS        24
+#define WATCH_COLS        80
+#define WATCH_MIN_MS      10
+#define WATCH_FIRST_ROW   3        // terminal row of the first output line, below the header
+
+int shell_watch_active(void);
+void shell_watch_poll(void);
+void shell_watch_stop(void);
+
+#endif /* SHELL_WATCH_H */
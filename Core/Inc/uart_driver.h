@@ -3,11 +3,131 @@
 
 #include "main.h"
 #include <stdarg.h>
+#include <stddef.h>
+
+// RX path selection
+#define UART_RX_MODE_IT   0   // HAL per-byte interrupt reception
+#define UART_RX_MODE_DMA  1   // DMA1 Stream5 circular buffer + IDLE line detection
+#define UART_RX_MODE_LL   2   // register-level RXNE handler, DR straight into the landing buffer
+
+#ifndef UART_RX_MODE
+#define UART_RX_MODE UART_RX_MODE_DMA
+#endif
+
+// TX path selection
+#define UART_TX_MODE_DMA  0   // DMA1 Stream6, one transfer per contiguous span of the queue
+#define UART_TX_MODE_IT   1   // TXE interrupt, one byte per interrupt (QEMU, which has no DMA model)
+
+#ifndef UART_TX_MODE
+#define UART_TX_MODE UART_TX_MODE_DMA
+#endif
+
+// TXE is fed from UART_LL_IRQHandler(); the HAL handler would take it for a HAL transfer
+#if UART_TX_MODE == UART_TX_MODE_IT && UART_RX_MODE != UART_RX_MODE_LL
+#error "UART_TX_MODE_IT requires UART_RX_MODE_LL"
+#endif
+
+#define UART_RX_BUFFER_SIZE 512
+#define UART_TX_BUFFER_SIZE 1024
+
+// What UART_Write does when the TX queue cannot take the whole message
+typedef enum {
+    UART_TX_BLOCK,      // wait up to the configured timeout for space, then drop the rest
+    UART_TX_DROP,       // drop the whole message
+    UART_TX_TRUNCATE    // queue what fits, drop the rest
+} UART_TxPolicy_t;
+
+// Flow control for bulk transfers, driven by RX buffer watermarks
+typedef enum {
+    UART_FLOW_NONE,
+    UART_FLOW_RTSCTS,   // CTS (PA0) gates TX in hardware, RTS (PA1) follows the watermarks
+    UART_FLOW_XONXOFF   // XOFF/XON sent on the watermarks, received ones pause/resume TX (not in RPC mode)
+} UART_FlowControl_t;
+
+/* Mode at reset. A pasted script can produce far more output than input
+ * ("status uart2" is 13 bytes in, ~720 out), so without flow control the
+ * RX backlog overruns within a few such lines whatever its size. XON/XOFF
+ * needs no extra wires, so it works over the ST-LINK VCP; build with
+ * -DUART_FLOW_DEFAULT=UART_FLOW_NONE for terminals that cannot honour it.
+ */
+#ifndef UART_FLOW_DEFAULT
+#define UART_FLOW_DEFAULT   UART_FLOW_XONXOFF
+#endif
+
+#define UART_FLOW_HIGH_PCT  75
+#define UART_FLOW_LOW_PCT   25
+#define UART_XON            0x11
+#define UART_XOFF           0x13
+#define UART_XONXOFF_MAX_SPAN 64    // bounds how long an XOFF can wait behind queued output
+
+// Baud rate derived from PCLK1: BRR value, oversampling and the rate actually achieved
+typedef struct {
+    uint32_t baud;
+    uint32_t actual;
+    int32_t error_ppm;
+    uint16_t brr;
+    uint8_t over8;
+} UART_BaudConfig_t;
+
+// RX interrupt profile, updated by the USART2 / DMA1 Stream5 handlers
+typedef struct {
+    uint32_t isr_count;
+    uint32_t isr_cycles;
+    uint32_t isr_max_cycles;
+    uint32_t rx_bytes;      // since the last UART_ResetRxProfile()
+    uint32_t rx_overflow;   // bytes lost because the landing buffer was full
+} UART_RxProfile_t;
+
+#define UART_STATS_WINDOW 10    // seconds of throughput history
+
+// Link statistics since boot, updated from the USART2 / DMA interrupt handlers
+typedef struct {
+    uint32_t rx_bytes;
+    uint32_t tx_bytes;
+    uint32_t overrun_errors;
+    uint32_t framing_errors;
+    uint32_t noise_errors;
+    uint32_t parity_errors;
+    uint32_t dma_errors;
+    uint32_t rx_dropped;        // landing buffer full
+    uint32_t tx_dropped;        // TX queue full, per UART_TxPolicy_t
+    uint16_t rx_high_water;     // most bytes ever waiting in the landing buffer
+    uint16_t tx_high_water;     // most bytes ever waiting in the TX queue
+    uint32_t rx_rate_1s;        // bytes/s over the last second
+    uint32_t tx_rate_1s;
+    uint32_t rx_rate_10s;       // bytes/s averaged over the last UART_STATS_WINDOW seconds
+    uint32_t tx_rate_10s;
+    uint32_t tx_blocked_cycles; // DWT cycles writers spent waiting for TX queue space (wraps)
+} UART_Stats_t;
 
 void UART_Init(void);
+void UART_StartReceive(void);
+size_t UART_RxPending(void);
+size_t UART_Read(uint8_t *dst, size_t len);
+size_t UART_Write(const uint8_t *data, size_t len);
+int UART_Flush(uint32_t timeout_ms);
+void UART_SetTxPolicy(UART_TxPolicy_t policy, uint32_t timeout_ms);
+uint32_t UART_GetTxDropped(void);
 void UART_Print(const char *format, ...);
+int UART_CalcBaud(uint32_t baud, UART_BaudConfig_t *cfg);
+int UART_SetBaud(uint32_t baud, UART_BaudConfig_t *cfg);
+uint32_t UART_GetBaud(void);
+int UART_SetFlowControl(UART_FlowControl_t mode);
+UART_FlowControl_t UART_GetFlowControl(void);
+void UART_FlowUpdate(uint32_t used, uint32_t capacity);
+int UART_RxThrottled(void);
+int UART_TxPaused(void);
 UART_HandleTypeDef* UART_GetHandle(void);
-extern uint8_t chrx;
+const UART_RxProfile_t* UART_GetRxProfile(void);
+void UART_ResetRxProfile(void);
+const UART_Stats_t* UART_GetStats(void);
+#if UART_RX_MODE == UART_RX_MODE_LL
+void UART_LL_IRQHandler(void);
+#endif
+
 extern UART_HandleTypeDef huart2;
+extern DMA_HandleTypeDef hdma_usart2_rx;
+extern DMA_HandleTypeDef hdma_usart2_tx;
+extern UART_RxProfile_t uart_rx_profile;
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,315 @@
+#include "fmt.h"
+#include <stdint.h>
+#include <string.h>
+
+#define FMT_FLAG_LEFT    0x01
+#define FMT_FLAG_PLUS    0x02
+#define FMT_FLAG_SPACE   0x04
+#define FMT_FLAG_ALT     0x08
+#define FMT_FLAG_ZERO    0x10
+#define FMT_FLAG_GROUP   0x20
+
+typedef struct {
+    fmt_write_fn write;
+    void *ctx;
+    char buf[FMT_CHUNK_SIZE];
+    size_t len;
+    int total;
+} FmtStream_t;
+
+typedef struct {
+    uint8_t flags;
+    int width;
+    int precision;      // -1 when not given
+} FmtSpec_t;
+
+static void fmt_flush(FmtStream_t *s) {
+    if (s->len > 0) {
+        s->write(s->ctx, s->buf, s->len);
+        s->len = 0;
+    }
+}
+
+static void fmt_putc(FmtStream_t *s, char c) {
+    if (s->len == FMT_CHUNK_SIZE) {
+        fmt_flush(s);
+    }
+    s->buf[s->len++] = c;
+    s->total++;
+}
+
+static void fmt_puts(FmtStream_t *s, const char *str, size_t n) {
+    // Long runs go to the sink directly, short ones are batched into the chunk
+    if (n > FMT_CHUNK_SIZE - s->len) {
+        fmt_flush(s);
+        if (n >= FMT_CHUNK_SIZE) {
+            s->write(s->ctx, str, n);
+            s->total += (int)n;
+            return;
+        }
+    }
+    memcpy(&s->buf[s->len], str, n);
+    s->len += n;
+    s->total += (int)n;
+}
+
+static void fmt_pad(FmtStream_t *s, char c, int n) {
+    while (n-- > 0) {
+        fmt_putc(s, c);
+    }
+}
+
+static void fmt_string(FmtStream_t *s, const char *str, const FmtSpec_t *spec) {
+    size_t n;
+
+    if (str == NULL) {
+        str = "(null)";
+    }
+    if (spec->precision >= 0) {
+        const char *end = memchr(str, '\0', (size_t)spec->precision);
+        n = end ? (size_t)(end - str) : (size_t)spec->precision;
+    } else {
+        n = strlen(str);
+    }
+
+    if (!(spec->flags & FMT_FLAG_LEFT)) {
+        fmt_pad(s, ' ', spec->width - (int)n);
+    }
+    fmt_puts(s, str, n);
+    if (spec->flags & FMT_FLAG_LEFT) {
+        fmt_pad(s, ' ', spec->width - (int)n);
+    }
+}
+
+static void fmt_number(FmtStream_t *s, unsigned long long v, int negative,
+                       unsigned base, int upper, const FmtSpec_t *spec) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char dig[64];           // reversed digits, 64 covers %llb
+    int nd = 0;
+    char sign = 0;
+    const char *prefix = "";
+    int group = 0;
+    char sep = '_';
+    int min_digits = (spec->precision >= 0) ? spec->precision : 1;
+    int len;
+
+    if (negative) {
+        sign = '-';
+    } else if (spec->flags & FMT_FLAG_PLUS) {
+        sign = '+';
+    } else if (spec->flags & FMT_FLAG_SPACE) {
+        sign = ' ';
+    }
+
+    if ((spec->flags & FMT_FLAG_ALT) && v != 0) {
+        if (base == 16) prefix = upper ? "0X" : "0x";
+        else if (base == 2) prefix = "0b";
+        else if (base == 8) prefix = "0";
+    }
+
+    if (spec->flags & FMT_FLAG_GROUP) {
+        group = (base == 10) ? 3 : 4;
+        sep = (base == 10) ? ',' : '_';
+    }
+
+    /* No runtime division: on the M4 a 64-bit one is an __aeabi_uldivmod
+     * call per digit. 2, 8 and 16 are shifts and masks; decimal only divides
+     * in 64 bits while the value does not fit 32, then by a constant 10,
+     * which the compiler turns into a multiply.
+     */
+    if (base != 10) {
+        unsigned shift = (base == 16) ? 4 : (base == 8) ? 3 : 1;
+
+        while (v != 0) {
+            dig[nd++] = digits[(unsigned)v & (base - 1)];
+            v >>= shift;
+        }
+    } else {
+        uint32_t w;
+
+        while (v > UINT32_MAX) {
+            dig[nd++] = digits[v % 10];
+            v /= 10;
+        }
+        for (w = (uint32_t)v; w != 0; w /= 10) {
+            dig[nd++] = digits[w % 10];
+        }
+    }
+
+    // '0' pads digits up to the field width, unless left-aligned or a precision is given
+    if ((spec->flags & FMT_FLAG_ZERO) && !(spec->flags & FMT_FLAG_LEFT) && spec->precision < 0) {
+        int avail = spec->width - (sign ? 1 : 0) - (int)strlen(prefix);
+        if (avail > min_digits) {
+            min_digits = avail;
+        }
+    }
+    if (min_digits > (int)sizeof(dig)) {
+        min_digits = sizeof(dig);
+    }
+    while (nd < min_digits) {
+        dig[nd++] = '0';
+    }
+
+    len = (sign ? 1 : 0) + (int)strlen(prefix) + nd + (group ? (nd - 1) / group : 0);
+
+    if (!(spec->flags & FMT_FLAG_LEFT)) {
+        fmt_pad(s, ' ', spec->width - len);
+    }
+    if (sign) {
+        fmt_putc(s, sign);
+    }
+    fmt_puts(s, prefix, strlen(prefix));
+    for (int i = nd - 1; i >= 0; i--) {
+        fmt_putc(s, dig[i]);
+        if (group && i > 0 && i % group == 0) {
+            fmt_putc(s, sep);
+        }
+    }
+    if (spec->flags & FMT_FLAG_LEFT) {
+        fmt_pad(s, ' ', spec->width - len);
+    }
+}
+
+int fmt_vprintf(fmt_write_fn write, void *ctx, const char *format, va_list args) {
+    FmtStream_t s;
+    const char *p = format;
+
+    s.write = write;
+    s.ctx = ctx;
+    s.len = 0;
+    s.total = 0;
+
+    while (*p) {
+        // Literal run: handed to the sink as-is, a specifier-free format is a single write
+        const char *pct = strchr(p, '%');
+        size_t run = pct ? (size_t)(pct - p) : strlen(p);
+        if (run > 0) {
+            fmt_puts(&s, p, run);
+            p += run;
+        }
+        if (!pct) {
+            break;
+        }
+        p++;
+
+        FmtSpec_t spec = { 0, 0, -1 };
+        int lng = 0;        // 0 int, 1 long, 2 long long, 3 size_t/intmax/ptrdiff
+        int half = 0;       // 1 h (short), 2 hh (char): int arguments narrowed as C requires
+
+        for (;; p++) {
+            if (*p == '-') spec.flags |= FMT_FLAG_LEFT;
+            else if (*p == '+') spec.flags |= FMT_FLAG_PLUS;
+            else if (*p == ' ') spec.flags |= FMT_FLAG_SPACE;
+            else if (*p == '#') spec.flags |= FMT_FLAG_ALT;
+            else if (*p == '0') spec.flags |= FMT_FLAG_ZERO;
+            else if (*p == '\'') spec.flags |= FMT_FLAG_GROUP;
+            else break;
+        }
+
+        if (*p == '*') {
+            spec.width = va_arg(args, int);
+            if (spec.width < 0) {
+                spec.flags |= FMT_FLAG_LEFT;
+                spec.width = -spec.width;
+            }
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') {
+                spec.width = spec.width * 10 + (*p++ - '0');
+            }
+        }
+
+        if (*p == '.') {
+            p++;
+            spec.precision = 0;
+            if (*p == '*') {
+                spec.precision = va_arg(args, int);
+                p++;
+            } else {
+                while (*p >= '0' && *p <= '9') {
+                    spec.precision = spec.precision * 10 + (*p++ - '0');
+                }
+            }
+        }
+
+        while (*p == 'h' || *p == 'l' || *p == 'z' || *p == 'j' || *p == 't') {
+            if (*p == 'l') lng++;
+            else if (*p == 'h') half++;
+            else lng = 3;
+            p++;
+        }
+
+        char conv = *p;
+        if (conv == '\0') {
+            break;
+        }
+        p++;
+
+        switch (conv) {
+            case 'd':
+            case 'i': {
+                long long v;
+                if (lng == 0) v = va_arg(args, int);
+                else if (lng == 1) v = va_arg(args, long);
+                else if (lng == 2) v = va_arg(args, long long);
+                else v = (long long)va_arg(args, ptrdiff_t);
+                if (lng == 0 && half == 1) v = (short)v;
+                else if (lng == 0 && half > 1) v = (signed char)v;
+                fmt_number(&s, v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v,
+                           v < 0, 10, 0, &spec);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            case 'b': {
+                unsigned long long v;
+                unsigned base = (conv == 'u') ? 10 : (conv == 'o') ? 8 : (conv == 'b') ? 2 : 16;
+                if (lng == 0) v = va_arg(args, unsigned int);
+                else if (lng == 1) v = va_arg(args, unsigned long);
+                else if (lng == 2) v = va_arg(args, unsigned long long);
+                else v = va_arg(args, size_t);
+                if (lng == 0 && half == 1) v = (unsigned short)v;
+                else if (lng == 0 && half > 1) v = (unsigned char)v;
+                fmt_number(&s, v, 0, base, conv == 'X', &spec);
+                break;
+            }
+            case 'p':
+                spec.flags |= FMT_FLAG_ALT;
+                fmt_number(&s, (uintptr_t)va_arg(args, void *), 0, 16, 0, &spec);
+                break;
+            case 'c': {
+                char c = (char)va_arg(args, int);
+                if (!(spec.flags & FMT_FLAG_LEFT)) fmt_pad(&s, ' ', spec.width - 1);
+                fmt_putc(&s, c);
+                if (spec.flags & FMT_FLAG_LEFT) fmt_pad(&s, ' ', spec.width - 1);
+                break;
+            }
+            case 's':
+                fmt_string(&s, va_arg(args, const char *), &spec);
+                break;
+            case '%':
+                fmt_putc(&s, '%');
+                break;
+            default:
+                // Unknown conversion: echo it so the mistake is visible
+                fmt_putc(&s, '%');
+                fmt_putc(&s, conv);
+                break;
+        }
+    }
+
+    fmt_flush(&s);
+    return s.total;
+}
+
+int fmt_printf(fmt_write_fn write, void *ctx, const char *format, ...) {
+    va_list args;
+    int n;
+
+    va_start(args, format);
+    n = fmt_vprintf(write, ctx, format, args);
+    va_end(args);
+    return n;
+}
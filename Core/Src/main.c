@@ -20,6 +20,9 @@
 #include "uart_driver.h"
 #include "gpio_driver.h"
 #include "shell.h"
+#include "shell_jobs.h"
+#include "rpc.h"
+#include "dwt.h"
 #include <string.h>
 
 #include "FreeRTOS.h"
@@ -33,12 +36,13 @@
 void SystemClock_Config(void);
 
 /* RTOS stuff*/
-SemaphoreHandle_t xBinarySemaphore = NULL;
-SemaphoreHandle_t xConsumeSemaphore = NULL;
 TaskHandle_t xUARTRxTaskHandle = NULL;
 TaskHandle_t xShellTaskHandle = NULL;
 TaskHandle_t xBlinkLEDTaskHandle = NULL;
 
+// Set by UARTRxTask when rx_buffer is full and it waits for the shell to make room
+static volatile uint8_t rx_stalled;
+
 // Task definitions
 void BlinkLed(void *pvParameters);
 void UARTRxTask(void *pvParameters);
@@ -54,16 +58,18 @@ int main(void)
     /* Reset of all peripherals, Initializes the Flash interface and the Systick. */
     HAL_Init();
     SystemClock_Config();
+    DWT_Init();
 
     GPIO_Init();
     UART_Init();
 
-    xBinarySemaphore = xSemaphoreCreateBinary();
-    xConsumeSemaphore = xSemaphoreCreateBinary();
-
-    /* Create tasks */
-    xTaskCreate(UARTRxTask, "UARTRx", 256, NULL, 1, &xUARTRxTaskHandle);
-    xTaskCreate(ProcessInput, "SHELL", 256, NULL, 2, &xShellTaskHandle);
+    /* Create tasks
+     * UARTRxTask runs above the shell so the DMA landing buffer is always
+     * moved into rx_buffer promptly, even while a command is executing.
+     */
+    xTaskCreate(UARTRxTask, "UARTRx", 256, NULL, 3, &xUARTRxTaskHandle);
+    xTaskCreate(ProcessInput, "SHELL", 512, NULL, 2, &xShellTaskHandle);
+    shell_jobs_init();
 
     /* Start scheduler */
     vTaskStartScheduler();
@@ -73,14 +79,50 @@ int main(void)
 }
 
 
+// Total RX backlog: bytes the shell has not consumed yet, wherever they sit
+static void rx_flow_update(void) {
+    UART_FlowUpdate(ring_count(&rx_buffer) + UART_RxPending(),
+                    ring_capacity(&rx_buffer) + UART_RX_BUFFER_SIZE);
+}
+
 void UARTRxTask(void *pvParameters) {
-    HAL_UART_Receive_IT(&huart2, &chrx, 1);
+    uint8_t *span;
+    uint32_t space;
+    size_t n;
+
+    UART_StartReceive();
 
     while (1) {
-        if (xSemaphoreTake(xBinarySemaphore, portMAX_DELAY) == pdTRUE) {
-            // add mutex lock for access to shared resource
-            buffer_putc(&rx_buffer, chrx);
-            xSemaphoreGive(xConsumeSemaphore);
+        // Task notifications count, so wakeups from back-to-back interrupts are never merged
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (1) {
+            /* Move everything the ISR/DMA has landed straight into the free span
+             * of rx_buffer, then wake the shell. rx_buffer is SPSC, so no
+             * locking is needed against ProcessInput.
+             */
+            while ((space = ring_write_span(&rx_buffer, &span)) > 0 &&
+                   (n = UART_Read(span, space)) > 0) {
+                // Ctrl+C has to reach a running command before the shell task gets to read it
+                if (!rpc_active() && memchr(span, 0x03, n) != NULL) {
+                    shell_interrupt();
+                }
+                ring_produce(&rx_buffer, n);
+            }
+            rx_flow_update();
+            xTaskNotifyGive(xShellTaskHandle);
+
+            if (UART_RxPending() == 0) {
+                break;
+            }
+
+            /* rx_buffer is full: wait for the shell to drain it. The landing
+             * buffer keeps receiving meanwhile; flow control (XON/XOFF by
+             * default) has already stopped the host at the high watermark.
+             * Anything that still overruns is counted as RX Dropped.
+             */
+            rx_stalled = 1;
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
         }
     }
 }
@@ -88,18 +130,47 @@ void UARTRxTask(void *pvParameters) {
 void ProcessInput(void *pvParameters) {
     shell_init();
     while (1) {
-        if (xSemaphoreTake(xConsumeSemaphore, portMAX_DELAY) == pdTRUE) {
-            process_input();
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Drain every byte available, not just one per wakeup
+        while (process_input() > 0) {
+            rx_flow_update();
+            if (rx_stalled) {
+                rx_stalled = 0;
+                xTaskNotifyGive(xUARTRxTaskHandle);
+            }
         }
+        shell_poll();
     }
 }
 
+// Block the shell task until UARTRxTask hands over more input or the timeout expires
+int shell_wait_input(uint32_t timeout_ms) {
+    return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) > 0;
+}
+
+// Wake the shell task for work other than input (e.g. a watch refresh from the timer task)
+void shell_wake(void) {
+    xTaskNotifyGive(xShellTaskHandle);
+}
+
 /**
   * @brief System Clock Configuration
   * @retval None
   */
 void SystemClock_Config(void)
 {
+#ifdef SHELL_QEMU
+  /* QEMU's netduinoplus2 models neither the RCC nor the flash interface, so
+   * the PLL would never report lock. The emulated core runs at a fixed
+   * 168 MHz, which is what SysTick counts; retime the HAL tick for it.
+   */
+  SystemCoreClock = configCPU_CLOCK_HZ;
+  if (HAL_InitTick(TICK_INT_PRIORITY) != HAL_OK)
+  {
+    Error_Handler();
+  }
+#else
   RCC_OscInitTypeDef RCC_OscInitStruct = {0};
   RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
 
@@ -138,6 +209,7 @@ void SystemClock_Config(void)
   {
     Error_Handler();
   }
+#endif
 }
 
 
@@ -176,6 +248,8 @@ void assert_failed(uint8_t *file, uint32_t line)
 #endif /* USE_FULL_ASSERT */
 
 /* FreeRTOS Hook Functions */
+volatile uint32_t ulContextSwitchCount;     // traceTASK_SWITCHED_IN(), see FreeRTOSConfig.h
+
 void vApplicationIdleHook(void) {
     /* Called when the idle task is running */
     /* You can put the MCU to sleep here if needed */
@@ -0,0 +1,109 @@
+#include "ring_buffer.h"
+#include <string.h>
+#include <stdatomic.h>
+
+/* Release: the data stores must be visible before the index that publishes
+ * them. Acquire: the index must be read before the data it covers. On the
+ * Cortex-M4 both compile to a DMB.
+ */
+#define RING_RELEASE() atomic_thread_fence(memory_order_release)
+#define RING_ACQUIRE() atomic_thread_fence(memory_order_acquire)
+
+void ring_init(RingBuffer_t *rb, uint8_t *storage, uint32_t capacity) {
+    rb->buffer = storage;
+    rb->mask = capacity - 1;
+    rb->head = 0;
+    rb->tail = 0;
+}
+
+void ring_reset(RingBuffer_t *rb) {
+    rb->tail = rb->head;
+}
+
+int ring_putc(RingBuffer_t *rb, uint8_t c) {
+    uint32_t head = rb->head;
+
+    if (head - rb->tail > rb->mask) {
+        return -1;
+    }
+    rb->buffer[head & rb->mask] = c;
+    RING_RELEASE();
+    rb->head = head + 1;
+    return 0;
+}
+
+uint32_t ring_write_span(RingBuffer_t *rb, uint8_t **span) {
+    uint32_t head = rb->head;
+    uint32_t space = ring_capacity(rb) - (head - rb->tail);
+    uint32_t to_end = ring_capacity(rb) - (head & rb->mask);
+
+    *span = &rb->buffer[head & rb->mask];
+    return space < to_end ? space : to_end;
+}
+
+void ring_produce(RingBuffer_t *rb, uint32_t len) {
+    RING_RELEASE();
+    rb->head += len;
+}
+
+uint32_t ring_write(RingBuffer_t *rb, const uint8_t *data, uint32_t len) {
+    uint32_t written = 0;
+    uint8_t *span;
+    uint32_t n;
+
+    // At most two spans: up to the end of storage, then from the start
+    while (written < len && (n = ring_write_span(rb, &span)) > 0) {
+        if (n > len - written) {
+            n = len - written;
+        }
+        memcpy(span, data + written, n);
+        ring_produce(rb, n);
+        written += n;
+    }
+    return written;
+}
+
+int ring_getc(RingBuffer_t *rb) {
+    uint32_t tail = rb->tail;
+    uint8_t c;
+
+    if (rb->head == tail) {
+        return -1;
+    }
+    RING_ACQUIRE();
+    c = rb->buffer[tail & rb->mask];
+    RING_RELEASE();
+    rb->tail = tail + 1;
+    return c;
+}
+
+uint32_t ring_peek_span(const RingBuffer_t *rb, const uint8_t **span) {
+    uint32_t tail = rb->tail;
+    uint32_t count = rb->head - tail;
+    uint32_t to_end = ring_capacity(rb) - (tail & rb->mask);
+
+    RING_ACQUIRE();
+    *span = &rb->buffer[tail & rb->mask];
+    return count < to_end ? count : to_end;
+}
+
+void ring_commit(RingBuffer_t *rb, uint32_t len) {
+    RING_RELEASE();
+    rb->tail += len;
+}
+
+uint32_t ring_read(RingBuffer_t *rb, uint8_t *dst, uint32_t len) {
+    uint32_t read = 0;
+    const uint8_t *span;
+    uint32_t n;
+
+    while (read < len && (n = ring_peek_span(rb, &span)) > 0) {
+        if (n > len - read) {
+            n = len - read;
+        }
+        memcpy(dst + read, span, n);
+        ring_commit(rb, n);
+        read += n;
+    }
+    return read;
+}
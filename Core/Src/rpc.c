@@ -0,0 +1,399 @@
+#include "rpc.h"
+#include "main.h"
+#include "shell.h"
+#include "shell_jobs.h"
+#include "uart_driver.h"
+#include <string.h>
+
+// seq + op + status + payload + crc
+#define RPC_MAX_FRAME       (3 + RPC_MAX_PAYLOAD + 4)
+#define RPC_MAX_ENCODED     (RPC_MAX_FRAME + RPC_MAX_FRAME / 254 + 2)
+
+static uint8_t rpc_mode;
+static uint8_t magic_pos;
+
+static uint8_t rx_frame[RPC_MAX_ENCODED];
+static size_t rx_len;
+static uint8_t rx_overflow;
+
+static uint8_t tx_frame[RPC_MAX_FRAME];
+static uint8_t tx_encoded[RPC_MAX_ENCODED];
+
+static uint8_t exec_buf[RPC_MAX_PAYLOAD];
+static size_t exec_len;
+static uint8_t exec_seq;
+
+static RpcStats_t rpc_stats;
+
+#ifdef SHELL_HOST
+// Target addresses mean nothing in a host process
+static int rpc_addr_ok(uint32_t addr, uint32_t len) {
+    (void)addr;
+    (void)len;
+    return 0;
+}
+#else
+// Address windows that can be read without a bus fault on the STM32F401xE
+static const struct {
+    uint32_t start;
+    uint32_t end;
+} rpc_regions[] = {
+    { 0x08000000, 0x08080000 },     // Flash, 512 KB
+    { 0x1FFF0000, 0x1FFF7A20 },     // System memory, OTP, unique ID
+    { 0x20000000, 0x20018000 },     // SRAM, 96 KB
+    { 0x40000000, 0x40008000 },     // APB1 peripherals
+    { 0x40010000, 0x40015800 },     // APB2 peripherals
+    { 0x40020000, 0x40026800 },     // AHB1 peripherals
+    { 0x50000000, 0x50040000 },     // AHB2 (USB OTG FS)
+    { 0xE0000000, 0xE0100000 },     // Cortex-M4 private peripherals
+};
+
+static int rpc_addr_ok(uint32_t addr, uint32_t len) {
+    for (size_t i = 0; i < sizeof(rpc_regions) / sizeof(rpc_regions[0]); i++) {
+        if (addr >= rpc_regions[i].start && len <= rpc_regions[i].end - addr) {
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst) {
+    size_t code_pos = 0;
+    size_t out = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (src[i] == 0) {
+            dst[code_pos] = code;
+            code_pos = out++;
+            code = 1;
+        } else {
+            dst[out++] = src[i];
+            if (++code == 0xFF) {
+                dst[code_pos] = code;
+                code_pos = out++;
+                code = 1;
+            }
+        }
+    }
+    dst[code_pos] = code;
+    return out;
+}
+
+int cobs_decode(const uint8_t *src, size_t len, uint8_t *dst) {
+    // Safe in place (dst == src): output never overtakes input
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < len) {
+        uint8_t code = src[in++];
+        if (code == 0 || in + code - 1 > len) {
+            return -1;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            dst[out++] = src[in++];
+        }
+        if (code != 0xFF && in < len) {
+            dst[out++] = 0;
+        }
+    }
+    return (int)out;
+}
+
+#if defined(SHELL_HOST) || defined(SHELL_QEMU)
+// No CRC unit off-target or under QEMU: the same CRC-32/MPEG-2 in software, over the same zero-padded words
+static uint32_t crc_word(uint32_t crc, uint32_t word) {
+    crc ^= word;
+    for (int bit = 0; bit < 32; bit++) {
+        crc = (crc & 0x80000000u) ? (crc << 1) ^ 0x04C11DB7u : crc << 1;
+    }
+    return crc;
+}
+
+uint32_t rpc_crc32(const uint8_t *data, size_t len) {
+    uint32_t crc = 0xFFFFFFFFu;
+    uint32_t word;
+
+    while (len >= 4) {
+        memcpy(&word, data, 4);
+        crc = crc_word(crc, word);
+        data += 4;
+        len -= 4;
+    }
+    if (len > 0) {
+        word = 0;
+        memcpy(&word, data, len);
+        crc = crc_word(crc, word);
+    }
+    return crc;
+}
+#else
+uint32_t rpc_crc32(const uint8_t *data, size_t len) {
+    uint32_t word;
+
+    CRC->CR = CRC_CR_RESET;
+    while (len >= 4) {
+        memcpy(&word, data, 4);
+        CRC->DR = word;
+        data += 4;
+        len -= 4;
+    }
+    if (len > 0) {
+        word = 0;
+        memcpy(&word, data, len);
+        CRC->DR = word;
+    }
+    return CRC->DR;
+}
+#endif
+
+static void rpc_send(uint8_t seq, uint8_t op, uint8_t status, const uint8_t *payload, size_t len) {
+    static const uint8_t delimiter = 0;
+    size_t n;
+    size_t encoded;
+
+    // tx_frame holds RPC_MAX_PAYLOAD bytes; anything longer is a caller bug, not data to send
+    if (len > RPC_MAX_PAYLOAD) {
+        status = RPC_STATUS_BAD_ARG;
+        len = 0;
+    }
+    n = 3 + len;
+
+    tx_frame[0] = seq;
+    tx_frame[1] = op | RPC_OP_RESPONSE;
+    tx_frame[2] = status;
+    if (len > 0) {
+        memcpy(&tx_frame[3], payload, len);
+    }
+    put_le32(&tx_frame[n], rpc_crc32(tx_frame, n));
+
+    encoded = cobs_encode(tx_frame, n + 4, tx_encoded);
+    UART_Write(tx_encoded, encoded);
+    UART_Write(&delimiter, 1);
+
+    rpc_stats.frames_tx++;
+    rpc_stats.bytes_tx += encoded + 1;
+}
+
+// Output sink used while an EXEC request runs: ships full chunks as MORE frames
+static void exec_sink(void *ctx, const char *data, size_t len) {
+    (void)ctx;
+
+    while (len > 0) {
+        size_t n = RPC_MAX_PAYLOAD - exec_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(&exec_buf[exec_len], data, n);
+        exec_len += n;
+        data += n;
+        len -= n;
+
+        if (exec_len == RPC_MAX_PAYLOAD) {
+            rpc_send(exec_seq, RPC_OP_EXEC, RPC_STATUS_MORE, exec_buf, exec_len);
+            exec_len = 0;
+        }
+    }
+}
+
+static void rpc_exec(uint8_t seq, const uint8_t *payload, size_t len) {
+    char command[CMD_BUFFER_SIZE];
+
+    if (len == 0 || len >= sizeof(command)) {
+        rpc_send(seq, RPC_OP_EXEC, RPC_STATUS_BAD_ARG, NULL, 0);
+        return;
+    }
+    memcpy(command, payload, len);
+    command[len] = '\0';
+
+    exec_seq = seq;
+    exec_len = 0;
+    shell_set_output(exec_sink, NULL);
+    shell_context()->cancel = 0;
+    process_command(command);
+    shell_set_output(NULL, NULL);
+
+    rpc_send(seq, RPC_OP_EXEC, RPC_STATUS_OK, exec_buf, exec_len);
+}
+
+static void rpc_read32(uint8_t seq, const uint8_t *payload, size_t len) {
+    uint8_t out[RPC_MAX_PAYLOAD];
+    uint32_t addr;
+    uint8_t count;
+
+    if (len != 5 || payload[4] == 0 || payload[4] > RPC_MAX_PAYLOAD / 4) {
+        rpc_send(seq, RPC_OP_READ32, RPC_STATUS_BAD_ARG, NULL, 0);
+        return;
+    }
+    addr = get_le32(payload);
+    count = payload[4];
+    if ((addr & 0x3) != 0 || !rpc_addr_ok(addr, (uint32_t)count * 4)) {
+        rpc_send(seq, RPC_OP_READ32, RPC_STATUS_BAD_ADDR, NULL, 0);
+        return;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        put_le32(&out[i * 4], ((volatile uint32_t *)(uintptr_t)addr)[i]);
+    }
+    rpc_send(seq, RPC_OP_READ32, RPC_STATUS_OK, out, (size_t)count * 4);
+}
+
+static void rpc_write32(uint8_t seq, const uint8_t *payload, size_t len) {
+    uint32_t addr;
+
+    if (len != 8) {
+        rpc_send(seq, RPC_OP_WRITE32, RPC_STATUS_BAD_ARG, NULL, 0);
+        return;
+    }
+    addr = get_le32(payload);
+    if ((addr & 0x3) != 0 || !rpc_addr_ok(addr, 4)) {
+        rpc_send(seq, RPC_OP_WRITE32, RPC_STATUS_BAD_ADDR, NULL, 0);
+        return;
+    }
+
+    *(volatile uint32_t *)(uintptr_t)addr = get_le32(&payload[4]);
+    rpc_send(seq, RPC_OP_WRITE32, RPC_STATUS_OK, NULL, 0);
+}
+
+static void rpc_readmem(uint8_t seq, const uint8_t *payload, size_t len) {
+    uint32_t addr;
+    uint32_t remaining;
+
+    if (len != 6) {
+        rpc_send(seq, RPC_OP_READMEM, RPC_STATUS_BAD_ARG, NULL, 0);
+        return;
+    }
+    addr = get_le32(payload);
+    remaining = (uint32_t)payload[4] | ((uint32_t)payload[5] << 8);
+    if (!rpc_addr_ok(addr, remaining)) {
+        rpc_send(seq, RPC_OP_READMEM, RPC_STATUS_BAD_ADDR, NULL, 0);
+        return;
+    }
+
+    // Bulk data goes out straight from memory, one frame per RPC_MAX_PAYLOAD bytes
+    while (remaining > RPC_MAX_PAYLOAD) {
+        rpc_send(seq, RPC_OP_READMEM, RPC_STATUS_MORE, (const uint8_t *)(uintptr_t)addr, RPC_MAX_PAYLOAD);
+        addr += RPC_MAX_PAYLOAD;
+        remaining -= RPC_MAX_PAYLOAD;
+    }
+    rpc_send(seq, RPC_OP_READMEM, RPC_STATUS_OK, (const uint8_t *)(uintptr_t)addr, remaining);
+}
+
+static void rpc_dispatch(uint8_t seq, uint8_t op, const uint8_t *payload, size_t len) {
+    // The receive buffer fits a few bytes more than a response can carry, and PING echoes them
+    if (len > RPC_MAX_PAYLOAD) {
+        rpc_send(seq, op, RPC_STATUS_BAD_ARG, NULL, 0);
+        return;
+    }
+
+    switch (op) {
+        case RPC_OP_PING:
+            rpc_send(seq, op, RPC_STATUS_OK, payload, len);
+            break;
+        case RPC_OP_EXEC:
+            rpc_exec(seq, payload, len);
+            break;
+        case RPC_OP_READ32:
+            rpc_read32(seq, payload, len);
+            break;
+        case RPC_OP_WRITE32:
+            rpc_write32(seq, payload, len);
+            break;
+        case RPC_OP_READMEM:
+            rpc_readmem(seq, payload, len);
+            break;
+        case RPC_OP_STATS:
+            rpc_send(seq, op, RPC_STATUS_OK, (const uint8_t *)&rpc_stats, sizeof(rpc_stats));
+            break;
+        case RPC_OP_EXIT:
+            rpc_send(seq, op, RPC_STATUS_OK, NULL, 0);
+            rpc_mode = 0;
+            shell_prompt();
+            break;
+        default:
+            rpc_send(seq, op, RPC_STATUS_BAD_OP, NULL, 0);
+            break;
+    }
+}
+
+int rpc_active(void) {
+    return rpc_mode;
+}
+
+int rpc_detect_magic(uint8_t c) {
+    static const char magic[] = RPC_MAGIC;
+
+    if (c == (uint8_t)magic[magic_pos]) {
+        if (++magic_pos == sizeof(magic) - 1) {
+            magic_pos = 0;
+            return 1;
+        }
+        return 0;
+    }
+    magic_pos = (c == (uint8_t)magic[0]) ? 1 : 0;
+    return 0;
+}
+
+void rpc_enter(void) {
+    uint8_t hello[3] = { RPC_VERSION, RPC_MAX_PAYLOAD & 0xFF, RPC_MAX_PAYLOAD >> 8 };
+
+    __HAL_RCC_CRC_CLK_ENABLE();
+    rpc_mode = 1;
+    rx_len = 0;
+    rx_overflow = 0;
+
+    rpc_send(0, RPC_OP_HELLO, RPC_STATUS_OK, hello, sizeof(hello));
+}
+
+void rpc_input(uint8_t c) {
+    int n;
+
+    rpc_stats.bytes_rx++;
+
+    if (c != 0) {
+        if (rx_len < sizeof(rx_frame)) {
+            rx_frame[rx_len++] = c;
+        } else {
+            rx_overflow = 1;
+        }
+        return;
+    }
+
+    // 0x00 ends a frame; empty frames are used by hosts to resynchronise
+    if (rx_len == 0) {
+        return;
+    }
+    n = rx_overflow ? -1 : cobs_decode(rx_frame, rx_len, rx_frame);
+    rx_len = 0;
+    rx_overflow = 0;
+
+    if (n < 6) {
+        rpc_stats.framing_errors++;
+        return;
+    }
+    rpc_stats.frames_rx++;
+
+    if (rpc_crc32(rx_frame, (size_t)n - 4) != get_le32(&rx_frame[n - 4])) {
+        rpc_stats.crc_errors++;
+        rpc_send(rx_frame[0], rx_frame[1], RPC_STATUS_BAD_CRC, NULL, 0);
+        return;
+    }
+
+    rpc_dispatch(rx_frame[0], rx_frame[1], &rx_frame[2], (size_t)n - 6);
+}
+
+const RpcStats_t* rpc_get_stats(void) {
+    return &rpc_stats;
+}
@@ -4,84 +4,191 @@
 #include "main.h"
 #include "shell.h"
 #include "uart_driver.h"
+#include "fmt.h"
+#include "dwt.h"
+#include "rpc.h"
+#include "shell_cmd.h"
+#include "shell_complete.h"
+#include "shell_history.h"
+#include "shell_line.h"
+#include "shell_vt.h"
+#include "shell_pipe.h"
+#include "shell_watch.h"
+#include "shell_jobs.h"
 
 #include <ctype.h>
+#include <stdlib.h>
 #include "stm32f401xe.h"
 #include "stm32f4xx_hal_uart.h"
 
-#define CMD_BUFFER_SIZE 124
-#define PRINT_BUFFER_SIZE 256
-#define RX_BUFFER_SIZE 256
-
 char cmd_buffer[CMD_BUFFER_SIZE];
-int cursor_pos;
+static ShellLine_t line = { cmd_buffer, CMD_BUFFER_SIZE, 0, 0 };
+static VtParser_t vt;
+
+// Learned from the cursor position report to VT_QUERY_WIDTH
+static uint16_t term_width = SHELL_DEFAULT_WIDTH;
+static uint8_t width_query_pending;
+
+
+_Static_assert(RING_IS_POW2(RX_BUFFER_SIZE), "RX_BUFFER_SIZE must be a power of two");
+_Static_assert(CMD_BUFFER_SIZE - 1 <= HISTORY_MAX_ENTRY, "history entries cannot hold a full command line");
+
+static uint8_t rx_storage[RX_BUFFER_SIZE];
+RingBuffer_t rx_buffer = { rx_storage, RX_BUFFER_SIZE - 1, 0, 0 };
+
+CommandHistory_t cmd_history_buffer;
+
+// Ctrl+R reverse incremental search
+typedef struct {
+    uint8_t active;
+    uint8_t failed;
+    uint8_t len;
+    char pattern[32];
+    uint32_t match;             // history position of the match shown, head before the first one
+} ShellSearch_t;
+
+static ShellSearch_t search;
+static uint8_t prev_tab;        // last key was Tab, so another one lists the candidates
+static uint8_t replaying;       // keybench is feeding keys between shell_replay_begin()/end()
 
+// The user's editor while shell_replay_begin() has swapped in a clean one
+static struct {
+    char buf[CMD_BUFFER_SIZE];
+    ShellLine_t line;
+    VtParser_t vt;
+    ShellSearch_t search;
+    uint8_t prev_tab;
+    CommandHistory_t history;
+} replay_saved;
 
-RingBuffer_t rx_buffer = {0};
+void save_cmd_to_history(CommandHistory_t *history, char *cmd) {
+    shell_history_add(history, cmd, strlen(cmd));
+}
+
+// Redraw the prompt and the whole line, cursor at the end
+static void show_line(void) {
+    line.cursor = line.len;
+    print_shell("\r" SHELL_PROMPT "%.*s\033[K", line.len, line.buf);
+}
 
-void buffer_putc(RingBuffer_t *rb, uint8_t c) {
-    if (rb->count < RX_BUFFER_SIZE) {
-        rb->buffer[rb->head] = c;
-        rb->head = (rb->head + 1) % RX_BUFFER_SIZE;
-        rb->count++;
+// History recall only re-sends the part that differs from the line on screen
+void show_previous_cmd(CommandHistory_t *history) {
+    char entry[CMD_BUFFER_SIZE];
+    int len = shell_history_prev(history, entry, sizeof(entry));
+
+    if (len >= 0) {
+        shell_line_replace(&line, entry, len);
     }
 }
 
-uint8_t buffer_getc(RingBuffer_t *rb) {
-    uint8_t ch;
-    if (rb->count > 0) {
-        ch = rb->buffer[rb->tail];
-        rb->tail = (rb->tail + 1) % RX_BUFFER_SIZE;
-        rb->count--;
-        return ch;
+void show_next_cmd(CommandHistory_t *history) {
+    char entry[CMD_BUFFER_SIZE];
+    int len = shell_history_next(history, entry, sizeof(entry));
+
+    if (len >= 0) {
+        shell_line_replace(&line, entry, len);
     }
-    return -1;
 }
 
-CommandHistory_t cmd_history_buffer = {0};
+static void search_redraw(void) {
+    print_shell("\r(%sreverse-i-search)`%.*s': %.*s\033[K", search.failed ? "failed " : "",
+                search.len, search.pattern, line.len, line.buf);
+}
 
-void save_cmd_to_history(CommandHistory_t *history, char *cmd) {
-    if (strlen(cmd) == 0)
-        return;
+// Look for the pattern in the entries older than pos; without a match the line keeps the last one
+static void search_from(uint32_t pos) {
+    if (shell_history_search(&cmd_history_buffer, &pos, search.pattern, search.len)) {
+        search.match = pos;
+        search.failed = 0;
+        line.len = (int)shell_history_read(&cmd_history_buffer, pos, line.buf, (size_t)line.size);
+        line.cursor = line.len;
+    } else {
+        search.failed = 1;
+    }
+    search_redraw();
+}
 
-    strncpy(history->commands[history->current_index], cmd, strlen(cmd));
-    history->history_count++;
-    cursor_pos = (int) strlen(history->commands[history->display_index]);
-    history->current_index = (history->current_index + 1) % CMD_HISTORY_SIZE;
-    history->display_index = history->current_index;
+static void search_start(void) {
+    search.active = 1;
+    search.failed = 0;
+    search.len = 0;
+    search.match = cmd_history_buffer.head;
+    shell_line_reset(&line);
+    search_redraw();
 }
 
-void show_previous_cmd(CommandHistory_t *history) {
-    if  (history->display_index == 0 || history->history_count == 0) {
-        return;
+// Returns 1 if the key was consumed by the search, 0 if it ends the search and needs normal handling
+static int search_input(const VtEvent_t *ev) {
+    const CommandHistory_t *history = &cmd_history_buffer;
+    uint8_t c = (uint8_t)ev->ch;
+
+    if (ev->key == VT_KEY_CTRL && c == 0x12) {          // Ctrl+R: next older match
+        search_from(search.match);
+        return 1;
     }
-    while (cursor_pos > 0) {
-        print_shell("\b \b");
-        cursor_pos--;
+    if (ev->key == VT_KEY_CTRL && c == 0x07) {          // Ctrl+G: give up, back to an empty line
+        search.active = 0;
+        shell_line_reset(&line);
+        show_line();
+        return 1;
+    }
+    if (ev->key == VT_KEY_CTRL && (c == '\b' || c == 127)) {
+        if (search.len > 0) {
+            search.len--;
+            search_from(history->head);
+        }
+        return 1;
+    }
+    if (ev->key == VT_KEY_CHAR) {
+        if (search.len < sizeof(search.pattern)) {
+            search.pattern[search.len++] = (char)c;
+            // The match shown may still contain the longer pattern
+            search_from(search.match == history->head ? history->head : shell_history_newer(history, search.match));
+        }
+        return 1;
     }
-    history->display_index = (history->display_index - 1) % CMD_HISTORY_SIZE;
-    print_shell("%s", history->commands[history->display_index]);
-    cursor_pos = (int) strlen(history->commands[history->display_index]);
-}
 
-void show_next_cmd(CommandHistory_t *history) {
-    while (cursor_pos > 0) {
-        cursor_pos--;
-        print_shell("\b \b");
+    // Anything else accepts the match into the line and is then handled as usual
+    search.active = 0;
+    shell_history_rewind(&cmd_history_buffer);
+    if (!(ev->key == VT_KEY_CTRL && c == 0x03)) {
+        show_line();
     }
-    history->display_index = (history->display_index + 1) % CMD_HISTORY_SIZE;
-    print_shell("%s", history->commands[history->display_index]);
-    cursor_pos = (int) strlen(history->commands[history->display_index]);
+    return 0;
+}
+
+static void shell_sink(void *ctx, const char *data, size_t len) {
+    (void)ctx;
+    UART_Write((const uint8_t *)data, len);
+}
+
+// The output sink belongs to the calling task's context, so a background job's redirection stays its own
+void shell_set_output(fmt_write_fn write, void *ctx) {
+    // Redirect print_shell output (e.g. into RPC frames); NULL restores the UART
+    ShellContext_t *c = shell_context();
+
+    c->out = write;
+    c->out_ctx = write ? ctx : NULL;
+}
+
+void shell_get_output(fmt_write_fn *write, void **ctx) {
+    ShellContext_t *c = shell_context();
+
+    *write = c->out ? c->out : shell_sink;
+    *ctx = c->out_ctx;
 }
 
 void print_shell(const char *format, ...) {
-    char _buffer[PRINT_BUFFER_SIZE];
+    // Formats straight into the current output sink in FMT_CHUNK_SIZE pieces, never truncates
+    ShellContext_t *c = shell_context();
     va_list args;
     va_start(args, format);
-    vsnprintf(_buffer, PRINT_BUFFER_SIZE, format, args);
+    fmt_vprintf(c->out ? c->out : shell_sink, c->out_ctx, format, args);
     va_end(args);
+}
 
-    HAL_UART_Transmit(UART_GetHandle(), (uint8_t *)_buffer, strlen(_buffer), HAL_MAX_DELAY);
+static void print_reg(const char *name, int width, uint32_t value) {
+    print_shell("%-*s0x%08lX  (%032lb)\r\n", width, name, (unsigned long)value, (unsigned long)value);
 }
 
 void uint32_to_binary_string(uint32_t num, char *buffer, size_t buffer_size) {
@@ -94,261 +201,481 @@ void uint32_to_binary_string(uint32_t num, char *buffer, size_t buffer_size) {
 }
 
 void shell_prompt(void) {
-    print_shell("STM32> ");
+    print_shell(SHELL_PROMPT);
     fflush(stdout);
-    cursor_pos = 0;
+    shell_line_reset(&line);
+}
+
+uint16_t shell_term_width(void) {
+    return term_width;
+}
+
+static void query_term_width(void) {
+    print_shell(VT_QUERY_WIDTH);
+    width_query_pending = 1;
 }
 
 void shell_init() {
-    cursor_pos = 0;
+    shell_line_reset(&line);
 
     print_shell("\r\n");
     print_shell("===============================================\r\n");
     print_shell("  STM32F401 Interactive Shell\r\n");
     print_shell("===============================================\r\n");
     print_shell("Type 'help' for available commands\r\n");
+    if (shell_cmd_verify() != 0) {
+        print_shell("warning: command table is not sorted or has an upper-case name, check .shell_cmd\r\n");
+    }
     print_shell("\r\n");
 
+    shell_vt_init(&vt);
+    query_term_width();
     shell_prompt();
+}
 
-    HAL_UART_Receive_IT(UART_GetHandle(), &chrx, 1);
+static void control_key(uint8_t c, uint8_t second_tab) {
+    switch (c) {
+        case 0x03: // Ctrl+C
+            print_shell("^C\r\n");
+            shell_history_rewind(&cmd_history_buffer);
+            shell_prompt();
+            break;
+        case 0x12: // Ctrl+R: reverse incremental history search
+            search_start();
+            break;
+        case 0x0C: { // Ctrl+L: clear the screen, re-learn its width, redraw the line
+            int cursor = line.cursor;
+
+            clear_cmd();
+            query_term_width();
+            show_line();
+            shell_line_move(&line, cursor);
+            break;
+        }
+        case 0x01: // Ctrl+A: start of line
+            shell_line_move(&line, 0);
+            break;
+        case 0x02: // Ctrl+B: back one character
+            shell_line_move(&line, line.cursor - 1);
+            break;
+        case 0x04: // Ctrl+D: delete under the cursor
+            shell_line_delete(&line, line.cursor, line.cursor + 1);
+            break;
+        case 0x05: // Ctrl+E: end of line
+            shell_line_move(&line, line.len);
+            break;
+        case 0x06: // Ctrl+F: forward one character
+            shell_line_move(&line, line.cursor + 1);
+            break;
+        case 0x0B: // Ctrl+K: kill to end of line
+            shell_line_delete(&line, line.cursor, line.len);
+            break;
+        case 0x15: // Ctrl+U: kill to start of line
+            shell_line_delete(&line, 0, line.cursor);
+            break;
+        case 0x17: // Ctrl+W: kill the word before the cursor
+            shell_line_delete(&line, shell_line_word_left(&line), line.cursor);
+            break;
+        case '\b':
+        case 127:  // Backspace
+            shell_line_delete(&line, line.cursor - 1, line.cursor);
+            break;
+        case '\n': // Enter
+            print_shell("\r\n");
+            if (line.len > 0) {
+                save_cmd_to_history(&cmd_history_buffer, line.buf);
+                // A new command starts uncancelled; a replayed Enter is nested in keybench
+                if (!replaying) {
+                    shell_context()->cancel = 0;
+                }
+                process_command(line.buf);
+            }
+            if (!shell_watch_active()) {
+                shell_prompt();
+            }
+            break;
+        case '\t': { // Tab: complete the word before the cursor, a second Tab lists the candidates
+            char completion[CMD_BUFFER_SIZE];
+            int n = shell_complete(line.buf, line.cursor, completion, sizeof(completion), second_tab);
+
+            if (n > 0) {
+                shell_line_insert(&line, completion, n);
+            } else if (n < 0) {
+                int cursor = line.cursor;
+
+                show_line();
+                shell_line_move(&line, cursor);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void meta_key(uint8_t c) {
+    switch (c) {
+        case 'b': // Alt+B: back one word
+            shell_line_move(&line, shell_line_word_left(&line));
+            break;
+        case 'f': // Alt+F: forward one word
+            shell_line_move(&line, shell_line_word_right(&line));
+            break;
+        case 'd': // Alt+D: kill the next word
+            shell_line_delete(&line, line.cursor, shell_line_word_right(&line));
+            break;
+        case '\b':
+        case 127:  // Alt+Backspace: kill the previous word
+            shell_line_delete(&line, shell_line_word_left(&line), line.cursor);
+            break;
+        default:
+            break;
+    }
 }
 
 void process_char(const uint8_t c) {
-    uint8_t esc_seq[4];
-    static int esc_count;
-    static int is_esc;
-
-    // Handle Ctl+C
-    if (c == 0x03) {
-        print_shell("^C\r\n");
-        is_esc = 0;
-        esc_count = 0;
-        cursor_pos = 0;
-        memset(cmd_buffer, 0, CMD_BUFFER_SIZE);
-        cmd_history_buffer.display_index = cmd_history_buffer.current_index;
-        shell_prompt();
+    uint8_t second_tab = prev_tab;
+    uint8_t word;
+    VtEvent_t ev;
 
+    // Binary RPC session: every byte belongs to the frame decoder
+    if (rpc_active()) {
+        rpc_input(c);
         return;
     }
-
-    if (c == 0x1B) {
-        is_esc = 1;
-        esc_count = 0;
-        esc_seq[esc_count++] = 0x1B;
+    if (rpc_detect_magic(c)) {
+        rpc_enter();
         return;
     }
 
-    if (is_esc) {
-        esc_seq[esc_count++] = c;
-        if (esc_count >= 3) {
-            esc_seq[esc_count] = '\0';
-            switch (esc_seq[2]) {
-                case 'A':
-                    show_previous_cmd(&cmd_history_buffer);
-                    break;
-                case 'B':
-                    show_next_cmd(&cmd_history_buffer);
-                    break;
-                case 'C': // Right Arrow
-                    if (cursor_pos < strlen(cmd_buffer)) {
-                        print_shell("%s", "\033[C");
-                        cursor_pos++;
-                    }
-                    break;
-                case 'D': // Left Arrow
-                    if (cursor_pos > 0) {
-                        print_shell("%s", "\033[D");
-                        cursor_pos--;
-                    }
-                    break;
-                default:
-                    break;
-            }
-            esc_count = 0;
-            is_esc = 0;
-            return;
+    // While a watch runs, input only serves to stop it
+    if (shell_watch_active()) {
+        if (c == 0x03) {
+            shell_watch_stop();
+            shell_prompt();
         }
         return;
     }
 
-    // Backspace
-    if (c == '\b' || c == 127) {
-        if (cursor_pos > 0) {
-            cursor_pos--;
-            print_shell("\b \b");
-        }
+    // Escape sequences are assembled by the decoder; only complete keys go further
+    if (!shell_vt_feed(&vt, c, &ev)) {
+        return;
     }
+    prev_tab = (ev.key == VT_KEY_CTRL && ev.ch == '\t');
 
-    // Enter
-    else if (c == '\n') {
-        print_shell("\r\n");
-        if (cursor_pos > 0) {
-            cmd_buffer[cursor_pos] = '\0';
-            save_cmd_to_history(&cmd_history_buffer, cmd_buffer);
-            process_command(cmd_buffer);
-            cursor_pos = 0;
+    if (ev.key == VT_KEY_CURSOR_REPORT) {
+        // Only trust it as the width when we asked; Shift+F3 looks the same
+        if (width_query_pending && ev.col >= SHELL_MIN_WIDTH) {
+            term_width = ev.col;
         }
-        shell_prompt();
+        width_query_pending = 0;
+        return;
     }
 
-    // printable characters
-    else if (c >= 32 && c <= 126) {
-        if (cursor_pos < CMD_BUFFER_SIZE) {
-            cmd_buffer[cursor_pos++] = c;
-            print_shell("%c", c);
-        }
+    if (search.active && search_input(&ev)) {
+        return;
     }
 
+    word = (ev.mods & (VT_MOD_CTRL | VT_MOD_ALT)) != 0;
+    switch (ev.key) {
+        case VT_KEY_CHAR:
+            shell_line_insert(&line, &ev.ch, 1);
+            break;
+        case VT_KEY_CTRL:
+            control_key((uint8_t)ev.ch, second_tab);
+            break;
+        case VT_KEY_META:
+            meta_key((uint8_t)ev.ch);
+            break;
+        case VT_KEY_UP:
+            show_previous_cmd(&cmd_history_buffer);
+            break;
+        case VT_KEY_DOWN:
+            show_next_cmd(&cmd_history_buffer);
+            break;
+        case VT_KEY_LEFT:
+            shell_line_move(&line, word ? shell_line_word_left(&line) : line.cursor - 1);
+            break;
+        case VT_KEY_RIGHT:
+            shell_line_move(&line, word ? shell_line_word_right(&line) : line.cursor + 1);
+            break;
+        case VT_KEY_HOME:
+            shell_line_move(&line, 0);
+            break;
+        case VT_KEY_END:
+            shell_line_move(&line, line.len);
+            break;
+        case VT_KEY_DELETE:
+            shell_line_delete(&line, line.cursor, line.cursor + 1);
+            break;
+        default:
+            break;
+    }
 }
 
-void process_input() {
-    const char c = buffer_getc(&rx_buffer);
-    process_char(c);
+void shell_replay_begin(void) {
+    memcpy(replay_saved.buf, cmd_buffer, sizeof(replay_saved.buf));
+    replay_saved.line = line;
+    replay_saved.vt = vt;
+    replay_saved.search = search;
+    replay_saved.prev_tab = prev_tab;
+    replay_saved.history = cmd_history_buffer;
+
+    shell_line_reset(&line);
+    shell_vt_init(&vt);
+    search.active = 0;
+    prev_tab = 0;
+    shell_history_clear(&cmd_history_buffer);
+    replaying = 1;
 }
 
-void process_command(char *command) {
-    // Supported commands:
-    //   help        - Show this help message
-    //   sysinfo     - Show system information
-    //   status      - Display status for peripherals (GPIOA, GPIOB, GPIOC, GPIOD, UART2, RCC, TIMER1)
-    //   echo        - Echo input text
-    //   led         - Control onboard LED (on|off|toggle)
-    //   showreg     - Show peripheral raw register values (UART2, GPIOA, TIMER1, etc.)
+void shell_replay_end(void) {
+    memcpy(cmd_buffer, replay_saved.buf, sizeof(replay_saved.buf));
+    line = replay_saved.line;
+    vt = replay_saved.vt;
+    search = replay_saved.search;
+    prev_tab = replay_saved.prev_tab;
+    cmd_history_buffer = replay_saved.history;
+    replaying = 0;
+}
 
-    if (strcmp("help", command) == 0) {
-        print_help_msg();
-    }
-    else if (strcmp("sysinfo", command) == 0) {
-        print_sys_info_msg();
+// Work the shell task does between input bursts
+void shell_poll(void) {
+    shell_watch_poll();
+
+    // Finished jobs are reported above the line being edited, which is then redrawn
+    if (!shell_watch_active() && !search.active && shell_jobs_poll() > 0) {
+        int cursor = line.cursor;
+
+        show_line();
+        shell_line_move(&line, cursor);
     }
-    else if (strncmp("status", command, 6) == 0) {
-        char *args = command + 6;
+}
 
-        // Trim whitespaces
-        while (*args == ' ' || *args == '\t') args++;
+// A trailing unquoted '&' asks for a background job; it is cut off, returns 1 if there was one
+static int strip_background(char *command) {
+    size_t len = strlen(command);
 
-        if (strcmp(args, "GPIOA") == 0 || strcmp(args, "gpioa") == 0) {
-            print_gpio_status_cmd(GPIOA, "GPIOA");
-        }
-        else if (strcmp(args, "GPIOB") == 0 || strcmp(args, "gpiob") == 0) {
-            print_gpio_status_cmd(GPIOB, "GPIOB");
-        }
-        else if (strcmp(args, "GPIOC") == 0 || strcmp(args, "gpioc") == 0) {
-            print_gpio_status_cmd(GPIOC, "GPIOC");
-        }
-        else if (strcmp(args, "GPIOD") == 0 || strcmp(args, "gpiod") == 0) {
-            print_gpio_status_cmd(GPIOD, "GPIOD");
-        }
-        else if (strcmp(args, "uart1") == 0 || strcmp(args, "UART1") == 0) {
-            print_uart_status_cmd(args);
-        }
-        else if (strcmp(args, "uart2") == 0 || strcmp(args, "UART2") == 0) {
-            print_uart_status_cmd(args);
-        }
-        else if (strcmp(args, "rcc") == 0 || strcmp(args, "RCC") == 0) {
-            print_rcc_status_cmd();
-        }
-        else if (strcmp(args, "timer1") == 0 || strcmp(args, "TIMER1") == 0) {
-            print_timer_status_cmd(args);
-        }
-        else {
-            print_shell("Usage: status <gpioa|gpiob|gpioc|gpiod|uart1|uart2|rcc|timer1>\r\n");
-            print_shell("Available peripherals: GPIOA, GPIOB, GPIOC, GPIOD, UART1, UART2, RCC, TIMER1\r\n");
+    while (len > 0 && (command[len - 1] == ' ' || command[len - 1] == '\t')) {
+        len--;
+    }
+    if (len == 0 || command[len - 1] != '&' || (len > 1 && command[len - 2] == '\\')) {
+        return 0;
+    }
+    command[len - 1] = '\0';
+    return 1;
+}
+
+uint32_t process_input() {
+    const uint8_t *span;
+    uint32_t n;
+
+    uint32_t i;
+
+    /* Consume one contiguous span of rx_buffer; returns 0 once it is empty.
+     * Each byte is committed before it is processed, because a command (e.g.
+     * baud) may read further input from rx_buffer itself; the span is then
+     * stale and the rest is left for the next call.
+     */
+    n = ring_peek_span(&rx_buffer, &span);
+    for (i = 0; i < n; i++) {
+        uint32_t tail = rx_buffer.tail;
+        uint8_t c = span[i];
+
+        ring_commit(&rx_buffer, 1);
+        process_char(c);
+        if (rx_buffer.tail != tail + 1) {
+            i++;
+            break;
         }
+    }
+    return i;
+}
 
+void process_command(char *command) {
+    /* Split off "| filter" stages, tokenize the command in place, look the
+     * name up in the registry and bind the words to the command's argument
+     * spec; the handler only runs when they match. Its output then streams
+     * through the filters. "command &" runs it on a job worker instead.
+     */
+    ShellPipe_t *pipe = &shell_context()->pipe;
+    char *segments[1 + SHELL_PIPE_MAX_FILTERS];
+    char *tokv[SHELL_MAX_ARGS];
+    const char *rawv[SHELL_MAX_ARGS];
+    uint16_t starts[SHELL_MAX_ARGS];
+    char source[CMD_BUFFER_SIZE];       // the command words as typed, for shell_args_rest()
+    ShellArg_t argv[SHELL_MAX_ARGS];
+    const ShellCommand_t *cmd;
+    size_t len;
+    int stages;
+    int tokc;
+    int argc;
+
+    if (strip_background(command) && !shell_in_background()) {
+        shell_job_start(command);
+        return;
     }
-    else if (strncmp("echo", command, 4) == 0) {
-        echo_cmd(command);
-    }
-    else if (strncmp("led", command, 3) == 0) {
-       char  *args = command + 3;
-       while (*args == ' ' || *args == '\t') args++;
-
-       if (strncmp(args, "on", 2) == 0) {
-           HAL_GPIO_WritePin(GPIOA, LD2_Pin, GPIO_PIN_SET);
-       }
-       else if (strncmp(args, "off", 3) == 0) {
-           HAL_GPIO_WritePin(GPIOA, LD2_Pin, GPIO_PIN_RESET);
-       }
-       else if (strncmp(args, "toggle", 6) == 0) {
-           HAL_GPIO_TogglePin(GPIOA, LD2_Pin);
-       }
-       else {
-           print_shell("Usage: led <on|off|toggle>\r\n");
-       }
-    }
-    else if (strncmp("showreg", command, 7) == 0) {
-        char *args = command + 7;
-        while (*args == ' ' || *args == '\t') args++; // Skip spaces
-
-        // Handle UART peripherals (STM32F401 has USART1 and USART2)
-        if (strncasecmp(args, "uart", 4) == 0 && strlen(args) >= 5) {
-            USART_TypeDef *uart = NULL;
-            switch (args[4]) {
-                case '1': uart = USART1; break;
-                case '2': uart = USART2; break;
-                default:
-                    print_shell("Available UARTs: uart1, uart2\r\n");
-                    return;
-            }
-            if (uart) {
-                showreg_uart(uart);
-            }
-        }
-        // Handle GPIO peripherals (STM32F401 has GPIOA, GPIOB, GPIOC, GPIOD)
-        else if (strncasecmp(args, "gpio", 4) == 0 && strlen(args) >= 5) {
-            GPIO_TypeDef *gpio = NULL;
-            switch (args[4]) {
-                case 'a': case 'A': gpio = GPIOA; break;
-                case 'b': case 'B': gpio = GPIOB; break;
-                case 'c': case 'C': gpio = GPIOC; break;
-                case 'd': case 'D': gpio = GPIOD; break;
-                default:
-                    print_shell("Available GPIOs: gpioa, gpiob, gpioc, gpiod\r\n");
-                    return;
-            }
-            if (gpio) {
-                showreg_gpio(gpio);
-            }
-        }
-        else if (strcmp(args, "rcc") == 0) {
-            showreg_rcc();
-        }
-        else if (strcmp(args, "timer1") == 0) {
-            showreg_timer1();
-        }
-        else {
-            print_shell("Usage: showreg <uart1|uart2|gpioa|gpiob|gpioc|gpiod|rcc|timer1>\r\n");
-            print_shell("Available peripherals: UART1, UART2, GPIOA, GPIOB, GPIOC, GPIOD, RCC, TIMER1\r\n");
+
+    stages = shell_pipe_split(command, segments, 1 + SHELL_PIPE_MAX_FILTERS);
+    if (stages < 0) {
+        print_shell("too many pipeline stages (max %d filters)\r\n", SHELL_PIPE_MAX_FILTERS);
+        return;
+    }
+
+    // Every caller's line fits CMD_BUFFER_SIZE, so source holds all of it
+    len = strlen(segments[0]);
+    if (len >= sizeof(source)) {
+        len = sizeof(source) - 1;
+    }
+    memcpy(source, segments[0], len);
+    source[len] = '\0';
+    tokc = shell_tokenize(segments[0], tokv, starts, SHELL_MAX_ARGS);
+    if (tokc == SHELL_TOK_ERR_QUOTE) {
+        print_shell("unterminated quote\r\n");
+        return;
+    }
+    if (tokc == SHELL_TOK_ERR_COUNT) {
+        print_shell("too many arguments (max %d)\r\n", SHELL_MAX_ARGS - 1);
+        return;
+    }
+    if (tokc == 0) {
+        if (stages > 1) {
+            print_shell("missing command before |\r\n");
         }
+        return;
+    }
+
+    cmd = shell_cmd_find(tokv[0], strlen(tokv[0]));
+    if (cmd == NULL) {
+        print_shell("unknown command: %s\r\n", tokv[0]);
+        return;
+    }
+    for (int t = 0; t < tokc; t++) {
+        rawv[t] = &source[starts[t]];
+    }
+    argc = shell_args_bind(cmd->name, cmd->args, tokc, tokv, rawv, argv);
+    if (argc < 0) {
+        return;
+    }
+
+    if (stages == 1) {
+        cmd->handler(argc, argv);
+        return;
+    }
+    if (shell_context()->piping) {
+        print_shell("%s: pipelines do not nest\r\n", cmd->name);
+        return;
+    }
+    if (shell_pipe_open(pipe, stages - 1, segments + 1) != 0) {
+        return;
+    }
+    shell_context()->piping = 1;
+    cmd->handler(argc, argv);
+    shell_pipe_close(pipe);
+    shell_context()->piping = 0;
+}
+
+void status_cmd(int argc, ShellArg_t *argv) {
+    const ShellPeriph_t *periph = argv[1].periph;
+
+    (void)argc;
+
+    switch (periph->kind) {
+        case PERIPH_GPIO:
+            print_gpio_status_cmd(periph->base, periph->label);
+            break;
+        case PERIPH_USART:
+            print_uart_status_cmd(periph->base);
+            break;
+        case PERIPH_RCC:
+            print_rcc_status_cmd();
+            break;
+        case PERIPH_TIM:
+            print_timer_status_cmd(periph->base);
+            break;
     }
-    else if (strncmp("clear", command, 6) == 0) {
-        clear_cmd();
+}
+SHELL_COMMAND(status, status_cmd, "<periph>", "Show peripheral status");
+
+void led_cmd(int argc, ShellArg_t *argv) {
+    (void)argc;
+
+    switch (argv[1].index) {
+        case 0:
+            HAL_GPIO_WritePin(GPIOA, LD2_Pin, GPIO_PIN_SET);
+            break;
+        case 1:
+            HAL_GPIO_WritePin(GPIOA, LD2_Pin, GPIO_PIN_RESET);
+            break;
+        default:
+            HAL_GPIO_TogglePin(GPIOA, LD2_Pin);
+            break;
     }
-    else {
-        print_shell("unknown command: %s\r\n", command);
+}
+SHELL_COMMAND(led, led_cmd, "<on|off|toggle>", "Control onboard LED");
+
+void showreg_cmd(int argc, ShellArg_t *argv) {
+    const ShellPeriph_t *periph = argv[1].periph;
+    const ShellReg_t *reg = argv[2].reg;
+
+    (void)argc;
+
+    if (reg != NULL) {
+        char label[12];
+        int i;
+
+        for (i = 0; reg->name[i] != '\0' && i < (int)sizeof(label) - 2; i++) {
+            label[i] = (char)toupper((unsigned char)reg->name[i]);
+        }
+        label[i++] = ':';
+        label[i] = '\0';
+        print_shell("%s ", periph->label);
+        print_reg(label, 7, *(volatile uint32_t *)((uintptr_t)periph->base + reg->offset));
+        return;
     }
 
+    switch (periph->kind) {
+        case PERIPH_GPIO:
+            showreg_gpio(periph->base);
+            break;
+        case PERIPH_USART:
+            showreg_uart(periph->base);
+            break;
+        case PERIPH_RCC:
+            showreg_rcc();
+            break;
+        case PERIPH_TIM:
+            showreg_timer1();
+            break;
+    }
 }
+SHELL_COMMAND(showreg, showreg_cmd, "<periph> [reg]", "Display raw register values");
 
 void print_help_msg(void) {
+    // Generated from the command registry, already in alphabetical order
     print_shell("\r\n");
     print_shell("=====================================================\r\n");
     print_shell("  Available Commands\r\n");
     print_shell("=====================================================\r\n");
-    print_shell("  help                      - Show this help message\r\n");
-    print_shell("  sysinfo                   - Display system information\r\n");
-    print_shell("  echo <text>               - Echo text back to console\r\n");
-    print_shell("  led <on|off|toggle>       - Control onboard LED\r\n");
-    print_shell("  gpio <port> <pin>         - Read GPIO pin state\r\n");
-    print_shell("  status                    - Show peripheral status\r\n");
-    print_shell("  showreg <periph> <reg>    - Display register value\r\n");
-    print_shell("  clear                     - Clear screen\r\n");
+    for (const ShellCommand_t *cmd = shell_cmd_begin(); cmd < shell_cmd_end(); cmd++) {
+        int used = (int)strlen(cmd->name) + (cmd->args[0] ? 1 + (int)strlen(cmd->args) : 0);
+        print_shell("  %s%s%s%*s - %s\r\n", cmd->name, cmd->args[0] ? " " : "", cmd->args,
+                    used < 25 ? 25 - used : 0, "", cmd->help);
+    }
+    print_shell("-----------------------------------------------------\r\n");
+    print_shell("  Output filters: <command> | <filter> [| <filter>...]\r\n");
+    shell_pipe_list_filters();
     print_shell("=====================================================\r\n");
     print_shell("\r\n");
 }
 
+static void help_cmd(int argc, ShellArg_t *argv) {
+    (void)argc;
+    (void)argv;
+    print_help_msg();
+}
+SHELL_COMMAND(help, help_cmd, "", "Show this help message");
+
 void print_sys_info_msg() {
     uint32_t sysclk = HAL_RCC_GetSysClockFreq();
     uint32_t hclk = HAL_RCC_GetHCLKFreq();
@@ -377,25 +704,242 @@ void print_sys_info_msg() {
 
 }
 
+static void sysinfo_cmd(int argc, ShellArg_t *argv) {
+    (void)argc;
+    (void)argv;
+    print_sys_info_msg();
+}
+SHELL_COMMAND(sysinfo, sysinfo_cmd, "", "Display system information");
+
 void clear_cmd() {
     print_shell("\033[2J");    // Clear screen
     print_shell("\033[H");     // Move cursor to home position
 }
 
-void echo_cmd(char *cmd) {
-    char *args = cmd + 4;
+static void clear_handler(int argc, ShellArg_t *argv) {
+    (void)argc;
+    (void)argv;
+    clear_cmd();
+}
+SHELL_COMMAND(clear, clear_handler, "", "Clear screen");
 
-    while (*args == ' ' || *args == '\t') {
-        args++;
+void echo_cmd(int argc, ShellArg_t *argv) {
+    for (int i = 1; i < argc; i++) {
+        print_shell("%s%s", i > 1 ? " " : "", argv[i].str);
     }
+    print_shell("\r\n");
+}
+SHELL_COMMAND(echo, echo_cmd, "[text...]", "Echo text back to console");
 
-    if (*args != '\0') {
-        print_shell("%s\r\n", args);
-    } else {
-        print_shell("\r\n");
+static void history_cmd(int argc, ShellArg_t *argv) {
+    const CommandHistory_t *history = &cmd_history_buffer;
+    char line[CMD_BUFFER_SIZE];
+    uint32_t n = history->total - history->count + 1;
+
+    (void)argv;
+
+    if (argc > 1) {
+        shell_history_clear(&cmd_history_buffer);
+        return;
     }
 
+    for (uint32_t pos = history->tail; pos != history->head; pos = shell_history_newer(history, pos)) {
+        shell_history_read(history, pos, line, sizeof(line));
+        print_shell("%5lu  %s\r\n", (unsigned long)n++, line);
+    }
+    print_shell("(%lu entries, %lu/%u bytes)\r\n", (unsigned long)history->count,
+                (unsigned long)(history->head - history->tail), HISTORY_ARENA_SIZE);
 }
+SHELL_COMMAND(history, history_cmd, "[clear]", "List command history, or clear it");
+
+void rx_profile_cmd(int argc, ShellArg_t *argv) {
+    (void)argv;
+
+    if (argc > 1) {
+        UART_ResetRxProfile();
+        return;
+    }
+
+    const UART_RxProfile_t *prof = UART_GetRxProfile();
+    print_shell("RX mode:        %s\r\n", UART_RX_MODE == UART_RX_MODE_DMA ? "DMA (circular + IDLE)" :
+                                        UART_RX_MODE == UART_RX_MODE_LL ? "LL (register-level RXNE)" : "HAL IT (per byte)");
+    print_shell("RX bytes:       %lu\r\n", (unsigned long)prof->rx_bytes);
+    print_shell("RX interrupts:  %lu\r\n", (unsigned long)prof->isr_count);
+    print_shell("ISR cycles:     %lu\r\n", (unsigned long)prof->isr_cycles);
+    print_shell("Max ISR cycles: %lu\r\n", (unsigned long)prof->isr_max_cycles);
+    if (prof->rx_bytes > 0) {
+        print_shell("Cycles/byte:    %lu\r\n", (unsigned long)(prof->isr_cycles / prof->rx_bytes));
+    }
+    print_shell("RX overflow:    %lu\r\n", (unsigned long)prof->rx_overflow);
+}
+SHELL_COMMAND(rxprof, rx_profile_cmd, "[reset]", "Show UART RX interrupt cost");
+
+static void print_baud_config(const UART_BaudConfig_t *cfg) {
+    int32_t err = cfg->error_ppm < 0 ? -cfg->error_ppm : cfg->error_ppm;
+
+    print_shell("  Requested:    %lu\r\n", (unsigned long)cfg->baud);
+    print_shell("  Achieved:     %lu (error %c%ld.%02ld%%)\r\n", (unsigned long)cfg->actual,
+                cfg->error_ppm < 0 ? '-' : '+', (long)(err / 10000), (long)((err / 100) % 100));
+    print_shell("  BRR:          0x%04X (OVER%d)\r\n", cfg->brr, cfg->over8 ? 8 : 16);
+}
+
+// Collect one line from rx_buffer, waiting at most timeout_ms; returns its length or -1
+static int read_reply(char *line, size_t size, uint32_t timeout_ms) {
+    uint32_t start = HAL_GetTick();
+    size_t len = 0;
+    int c;
+
+    while (HAL_GetTick() - start < timeout_ms) {
+        while ((c = ring_getc(&rx_buffer)) >= 0) {
+            if (c == '\r' || c == '\n') {
+                if (len > 0) {
+                    line[len] = '\0';
+                    return (int)len;
+                }
+            } else if (len < size - 1) {
+                line[len++] = (char)c;
+            }
+        }
+        shell_wait_input(timeout_ms - (HAL_GetTick() - start));
+    }
+    return -1;
+}
+
+void baud_cmd(int argc, ShellArg_t *argv) {
+    /* Host-initiated switch:
+     *   host  -> "baud 921600"                  (old rate)
+     *   shell -> "baud: switching ..." + flush  (old rate)
+     *   shell -> BAUD_PROBE_PATTERN             (new rate)
+     *   host  -> "ok"                           (new rate, within BAUD_PROBE_TIMEOUT_MS)
+     * Anything else, or silence, restores the previous rate.
+     */
+    UART_BaudConfig_t cfg;
+    uint32_t old_baud = UART_GetBaud();
+    char reply[16];
+
+    if (shell_in_background()) {
+        print_shell("baud: foreground only\r\n");
+        return;
+    }
+    if (argc < 2) {
+        UART_CalcBaud(old_baud, &cfg);
+        print_shell("UART2 baud rate:\r\n");
+        print_baud_config(&cfg);
+        return;
+    }
+
+    uint32_t baud = argv[1].num;
+    if (UART_CalcBaud(baud, &cfg) != 0) {
+        print_shell("baud: %lu not reachable from PCLK1 (%lu Hz)\r\n", (unsigned long)baud,
+                    (unsigned long)HAL_RCC_GetPCLK1Freq());
+        return;
+    }
+    if (cfg.error_ppm > BAUD_MAX_ERROR_PPM || cfg.error_ppm < -BAUD_MAX_ERROR_PPM) {
+        print_shell("baud: %lu rejected, error too large\r\n", (unsigned long)baud);
+        print_baud_config(&cfg);
+        return;
+    }
+
+    print_shell("baud: switching to %lu, reply \"ok\" within %d ms\r\n", (unsigned long)baud, BAUD_PROBE_TIMEOUT_MS);
+    print_baud_config(&cfg);
+
+    if (UART_SetBaud(baud, &cfg) != 0) {
+        print_shell("baud: output did not drain, staying at %lu\r\n", (unsigned long)old_baud);
+        return;
+    }
+    ring_reset(&rx_buffer);
+    print_shell("%s", BAUD_PROBE_PATTERN);
+
+    if (read_reply(reply, sizeof(reply), BAUD_PROBE_TIMEOUT_MS) >= 0 && strcmp(reply, "ok") == 0) {
+        print_shell("baud: locked at %lu\r\n", (unsigned long)baud);
+        return;
+    }
+
+    if (UART_SetBaud(old_baud, NULL) != 0) {
+        print_shell("\r\nbaud: probe failed, output did not drain, still at %lu\r\n", (unsigned long)baud);
+        return;
+    }
+    ring_reset(&rx_buffer);
+    print_shell("\r\nbaud: probe failed, reverted to %lu\r\n", (unsigned long)old_baud);
+}
+SHELL_COMMAND(baud, baud_cmd, "[rate:int]", "Show or negotiate the UART baud rate");
+
+void flow_cmd(int argc, ShellArg_t *argv) {
+    // Word order in the spec matches UART_FlowControl_t
+    static const char *const names[] = { "none", "rtscts", "xonxoff" };
+
+    if (argc > 1 && UART_SetFlowControl((UART_FlowControl_t)argv[1].index) != 0) {
+        print_shell("flow: output held back by CTS or XOFF did not drain, unchanged\r\n");
+    }
+
+    print_shell("UART2 flow control: %s\r\n", names[UART_GetFlowControl()]);
+    print_shell("  Watermarks:   %d%% / %d%% of %lu bytes\r\n", UART_FLOW_HIGH_PCT, UART_FLOW_LOW_PCT,
+                (unsigned long)(ring_capacity(&rx_buffer) + UART_RX_BUFFER_SIZE));
+    print_shell("  RX throttled: %s\r\n", UART_RxThrottled() ? "yes" : "no");
+    print_shell("  TX paused:    %s\r\n", UART_TxPaused() ? "yes (XOFF)" : "no");
+}
+SHELL_COMMAND(flow, flow_cmd, "[none|rtscts|xonxoff]", "Show or set UART flow control");
+
+static void null_sink(void *ctx, const char *data, size_t len) {
+    (void)ctx;
+    (void)data;
+    (void)len;
+}
+
+static int bench_vsnprintf(const char *format, ...) {
+    // The old print_shell path: render into a stack buffer, then strlen it
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return (int)strlen(buffer);
+}
+
+void fmt_bench_cmd(int argc, ShellArg_t *argv) {
+    // Same work on both paths, output discarded so only formatting is measured
+    const int iterations = 100;
+    const uint32_t reg = 0xA80004A0;
+    char bin[33];
+    uint32_t start, fmt_const, fmt_reg, libc_const, libc_reg;
+
+    (void)argc;
+    (void)argv;
+
+    start = DWT_GetCycles();
+    for (int i = 0; i < iterations; i++) {
+        fmt_printf(null_sink, NULL, "===============================================\r\n");
+    }
+    fmt_const = DWT_GetCycles() - start;
+
+    start = DWT_GetCycles();
+    for (int i = 0; i < iterations; i++) {
+        fmt_printf(null_sink, NULL, "%-*s0x%08lX  (%032lb)\r\n", 9, "MODER:", (unsigned long)reg, (unsigned long)reg);
+    }
+    fmt_reg = DWT_GetCycles() - start;
+
+    start = DWT_GetCycles();
+    for (int i = 0; i < iterations; i++) {
+        bench_vsnprintf("===============================================\r\n");
+    }
+    libc_const = DWT_GetCycles() - start;
+
+    start = DWT_GetCycles();
+    for (int i = 0; i < iterations; i++) {
+        uint32_to_binary_string(reg, bin, sizeof(bin));
+        bench_vsnprintf("MODER:   0x%08lX  (%s)\r\n", (unsigned long)reg, bin);
+    }
+    libc_reg = DWT_GetCycles() - start;
+
+    if (shell_cancelled()) {
+        return;
+    }
+    print_shell("Cycles per call (avg of %d):\r\n", iterations);
+    print_shell("                   fmt      vsnprintf\r\n");
+    print_shell("  constant line:   %-8lu %lu\r\n", (unsigned long)(fmt_const / iterations), (unsigned long)(libc_const / iterations));
+    print_shell("  register line:   %-8lu %lu\r\n", (unsigned long)(fmt_reg / iterations), (unsigned long)(libc_reg / iterations));
+}
+SHELL_COMMAND(fmtbench, fmt_bench_cmd, "", "Compare print_shell formatter with vsnprintf");
 
 // void print_gpio_status_cmd_(GPIO_TypeDef *GPIOx, const char *port_name) {
 //     /*
@@ -548,34 +1092,101 @@ void print_gpio_status_cmd(GPIO_TypeDef *GPIOx, const char *port_name) {
     print_shell("  ODR: 0x%04X\r\n", (unsigned int)(GPIOx->ODR & 0xFFFF));
 }
 
-void print_uart_status_cmd(char *args) {
+void print_uart_status_cmd(USART_TypeDef *usart) {
     /*
     === USART2 Status ===
     Configuration:
-      Baud Rate:    115200
+      Baud Rate:    115068  (BRR 0x016D, OVER16, PCLK1 42000000 Hz)
       Data Bits:    8
       Stop Bits:    1
       Parity:       None
       Mode:         TX + RX
       Flow Control: None
+      DMA:          RX + TX
+      Interrupts:   RXNE PE ERR
 
     Pins:
       TX: PA2 (AF7)
       RX: PA3 (AF7)
 
-    Status:
-      USART:        Enabled
-      TX Buffer:    Empty (ready to send)
-      RX Buffer:    Empty (no data)
-      Errors:       None
-
     Statistics:
-      Overrun Errors:   0
-      Framing Errors:   0
-      Parity Errors:    0
+      RX Bytes:         1234      (1s: 12 B/s, 10s: 3 B/s)
+      ...
     */
+    static const char *const stop_map[] = { "1", "0.5", "2", "1.5" };
+    int is_uart1 = (usart == USART1);
+    uint32_t clk_enabled = is_uart1 ? (RCC->APB2ENR & RCC_APB2ENR_USART1EN) : (RCC->APB1ENR & RCC_APB1ENR_USART2EN);
+    uint32_t pclk = is_uart1 ? HAL_RCC_GetPCLK2Freq() : HAL_RCC_GetPCLK1Freq();
+
+    print_shell("=== USART%c Status ===\r\n", is_uart1 ? '1' : '2');
+    if (!clk_enabled) {
+        print_shell("  Clock disabled, peripheral not in use\r\n");
+        return;
+    }
 
-    // TODO: Implementation - High-level UART status
+    uint32_t sr = usart->SR;
+    uint32_t brr = usart->BRR & 0xFFFF;
+    uint32_t cr1 = usart->CR1;
+    uint32_t cr2 = usart->CR2;
+    uint32_t cr3 = usart->CR3;
+    int over8 = (cr1 & USART_CR1_OVER8) != 0;
+
+    // BRR holds USARTDIV in 1/16 (OVER16) or 1/8 (OVER8, fraction in bits 2:0)
+    uint32_t div = over8 ? ((brr >> 4) << 3) | (brr & 0x7) : brr;
+    int frame_bits = (cr1 & USART_CR1_M) ? 9 : 8;
+    int parity = (cr1 & USART_CR1_PCE) != 0;
+
+    print_shell("Configuration:\r\n");
+    print_shell("  USART:        %s\r\n", (cr1 & USART_CR1_UE) ? "Enabled" : "Disabled");
+    if (div != 0) {
+        print_shell("  Baud Rate:    %lu  (BRR 0x%04lX, %s, PCLK%c %lu Hz)\r\n", (unsigned long)(pclk / div),
+                    (unsigned long)brr, over8 ? "OVER8" : "OVER16", is_uart1 ? '2' : '1', (unsigned long)pclk);
+    } else {
+        print_shell("  Baud Rate:    not set (BRR 0)\r\n");
+    }
+    print_shell("  Data Bits:    %d\r\n", frame_bits - parity);
+    print_shell("  Stop Bits:    %s\r\n", stop_map[(cr2 & USART_CR2_STOP) >> USART_CR2_STOP_Pos]);
+    print_shell("  Parity:       %s\r\n", !parity ? "None" : (cr1 & USART_CR1_PS) ? "Odd" : "Even");
+    print_shell("  Mode:         %s%s%s\r\n", (cr1 & USART_CR1_TE) ? "TX" : "",
+                ((cr1 & USART_CR1_TE) && (cr1 & USART_CR1_RE)) ? " + " : "", (cr1 & USART_CR1_RE) ? "RX" : "");
+    print_shell("  Flow Control: %s%s%s\r\n", (cr3 & (USART_CR3_RTSE | USART_CR3_CTSE)) ? "" : "None",
+                (cr3 & USART_CR3_RTSE) ? "RTS " : "", (cr3 & USART_CR3_CTSE) ? "CTS" : "");
+    print_shell("  DMA:          %s%s%s\r\n", (cr3 & (USART_CR3_DMAR | USART_CR3_DMAT)) ? "" : "None",
+                (cr3 & USART_CR3_DMAR) ? "RX " : "", (cr3 & USART_CR3_DMAT) ? "TX" : "");
+    print_shell("  Interrupts:   %s%s%s%s%s%s\r\n",
+                (cr1 & USART_CR1_RXNEIE) ? "RXNE " : "", (cr1 & USART_CR1_TXEIE) ? "TXE " : "",
+                (cr1 & USART_CR1_TCIE) ? "TC " : "", (cr1 & USART_CR1_IDLEIE) ? "IDLE " : "",
+                (cr1 & USART_CR1_PEIE) ? "PE " : "", (cr3 & USART_CR3_EIE) ? "ERR" : "");
+    print_shell("  Flags (SR):   %s%s%s%s%s%s%s\r\n",
+                (sr & USART_SR_TXE) ? "TXE " : "", (sr & USART_SR_TC) ? "TC " : "",
+                (sr & USART_SR_RXNE) ? "RXNE " : "", (sr & USART_SR_IDLE) ? "IDLE " : "",
+                (sr & USART_SR_ORE) ? "ORE " : "", (sr & USART_SR_FE) ? "FE " : "",
+                (sr & (USART_SR_NE | USART_SR_PE)) ? "NE/PE" : "");
+
+    print_shell("\r\nPins:\r\n");
+    if (is_uart1) {
+        print_shell("  TX: PA9 (AF7)\r\n");
+        print_shell("  RX: PA10 (AF7)\r\n");
+        return;
+    }
+    print_shell("  TX: PA2 (AF7)\r\n");
+    print_shell("  RX: PA3 (AF7)\r\n");
+
+    const UART_Stats_t *st = UART_GetStats();
+    print_shell("\r\nStatistics:\r\n");
+    print_shell("  RX Bytes:         %-10lu (1s: %lu B/s, 10s: %lu B/s)\r\n", (unsigned long)st->rx_bytes,
+                (unsigned long)st->rx_rate_1s, (unsigned long)st->rx_rate_10s);
+    print_shell("  TX Bytes:         %-10lu (1s: %lu B/s, 10s: %lu B/s)\r\n", (unsigned long)st->tx_bytes,
+                (unsigned long)st->tx_rate_1s, (unsigned long)st->tx_rate_10s);
+    print_shell("  Overrun Errors:   %lu\r\n", (unsigned long)st->overrun_errors);
+    print_shell("  Framing Errors:   %lu\r\n", (unsigned long)st->framing_errors);
+    print_shell("  Noise Errors:     %lu\r\n", (unsigned long)st->noise_errors);
+    print_shell("  Parity Errors:    %lu\r\n", (unsigned long)st->parity_errors);
+    print_shell("  DMA Errors:       %lu\r\n", (unsigned long)st->dma_errors);
+    print_shell("  RX Dropped:       %lu\r\n", (unsigned long)st->rx_dropped);
+    print_shell("  TX Dropped:       %lu\r\n", (unsigned long)st->tx_dropped);
+    print_shell("  RX High Water:    %u / %u\r\n", st->rx_high_water, UART_RX_BUFFER_SIZE - 1);
+    print_shell("  TX High Water:    %u / %u\r\n", st->tx_high_water, UART_TX_BUFFER_SIZE);
 }
 
 void showreg_uart(USART_TypeDef* USARTx) {
@@ -590,27 +1201,13 @@ void showreg_uart(USART_TypeDef* USARTx) {
     GTPR: 0x00000000  (00000000000000000000000000000000)
     */
 
-    char buff[33];
-    uint32_to_binary_string(USARTx->SR, buff, 33);
-    print_shell("SR:   0x%08lX  (%s)\r\n", (unsigned long)USARTx->SR, buff);
-
-    uint32_to_binary_string(USARTx->DR, buff, 33);
-    print_shell("DR:   0x%08lX  (%s)\r\n", (unsigned long)USARTx->DR, buff);
-
-    uint32_to_binary_string(USARTx->BRR, buff, 33);
-    print_shell("BRR:  0x%08lX  (%s)\r\n", (unsigned long)USARTx->BRR, buff);
-
-    uint32_to_binary_string(USARTx->CR1, buff, 33);
-    print_shell("CR1:  0x%08lX  (%s)\r\n", (unsigned long)USARTx->CR1, buff);
-
-    uint32_to_binary_string(USARTx->CR2, buff, 33);
-    print_shell("CR2:  0x%08lX  (%s)\r\n", (unsigned long)USARTx->CR2, buff);
-
-    uint32_to_binary_string(USARTx->CR3, buff, 33);
-    print_shell("CR3:  0x%08lX  (%s)\r\n", (unsigned long)USARTx->CR3, buff);
-
-    uint32_to_binary_string(USARTx->GTPR, buff, 33);
-    print_shell("GTPR: 0x%08lX  (%s)\r\n", (unsigned long)USARTx->GTPR, buff);
+    print_reg("SR:", 6, USARTx->SR);
+    print_reg("DR:", 6, USARTx->DR);
+    print_reg("BRR:", 6, USARTx->BRR);
+    print_reg("CR1:", 6, USARTx->CR1);
+    print_reg("CR2:", 6, USARTx->CR2);
+    print_reg("CR3:", 6, USARTx->CR3);
+    print_reg("GTPR:", 6, USARTx->GTPR);
 }
 
 void showreg_gpio(GPIO_TypeDef *GPIOx) {
@@ -628,37 +1225,16 @@ void showreg_gpio(GPIO_TypeDef *GPIOx) {
     AFR[1]:  0x00000000  (00000000000000000000000000000000)
     */
 
-    char buff[33];
-
-    uint32_to_binary_string(GPIOx->MODER, buff, 33);
-    print_shell("MODER:   0x%08lX  (%s)\r\n", (unsigned long)GPIOx->MODER, buff);
-
-    uint32_to_binary_string(GPIOx->OTYPER, buff, 33);
-    print_shell("OTYPER:  0x%08lX  (%s)\r\n", (unsigned long)GPIOx->OTYPER, buff);
-
-    uint32_to_binary_string(GPIOx->OSPEEDR, buff, 33);
-    print_shell("OSPEEDR: 0x%08lX  (%s)\r\n", (unsigned long)GPIOx->OSPEEDR, buff);
-
-    uint32_to_binary_string(GPIOx->PUPDR, buff, 33);
-    print_shell("PUPDR:   0x%08lX  (%s)\r\n", (unsigned long)GPIOx->PUPDR, buff);
-
-    uint32_to_binary_string(GPIOx->IDR, buff, 33);
-    print_shell("IDR:     0x%08lX  (%s)\r\n", (unsigned long)GPIOx->IDR, buff);
-
-    uint32_to_binary_string(GPIOx->ODR, buff, 33);
-    print_shell("ODR:     0x%08lX  (%s)\r\n", (unsigned long)GPIOx->ODR, buff);
-
-    uint32_to_binary_string(GPIOx->BSRR, buff, 33);
-    print_shell("BSRR:    0x%08lX  (%s)\r\n", (unsigned long)GPIOx->BSRR, buff);
-
-    uint32_to_binary_string(GPIOx->LCKR, buff, 33);
-    print_shell("LCKR:    0x%08lX  (%s)\r\n", (unsigned long)GPIOx->LCKR, buff);
-
-    uint32_to_binary_string(GPIOx->AFR[0], buff, 33);
-    print_shell("AFR[0]:  0x%08lX  (%s)\r\n", (unsigned long)GPIOx->AFR[0], buff);
-
-    uint32_to_binary_string(GPIOx->AFR[1], buff, 33);
-    print_shell("AFR[1]:  0x%08lX  (%s)\r\n", (unsigned long)GPIOx->AFR[1], buff);
+    print_reg("MODER:", 9, GPIOx->MODER);
+    print_reg("OTYPER:", 9, GPIOx->OTYPER);
+    print_reg("OSPEEDR:", 9, GPIOx->OSPEEDR);
+    print_reg("PUPDR:", 9, GPIOx->PUPDR);
+    print_reg("IDR:", 9, GPIOx->IDR);
+    print_reg("ODR:", 9, GPIOx->ODR);
+    print_reg("BSRR:", 9, GPIOx->BSRR);
+    print_reg("LCKR:", 9, GPIOx->LCKR);
+    print_reg("AFR[0]:", 9, GPIOx->AFR[0]);
+    print_reg("AFR[1]:", 9, GPIOx->AFR[1]);
 }
 
 void print_rcc_status_cmd() {
@@ -708,48 +1284,23 @@ void showreg_rcc() {
     APB2ENR:  0x00004000  (00000000000000000100000000000000)
     */
 
-    char buff[33];
-
     print_shell("=== RCC Raw Registers ===\r\n");
 
-    uint32_to_binary_string(RCC->CR, buff, 33);
-    print_shell("CR:       0x%08lX  (%s)\r\n", (unsigned long)RCC->CR, buff);
-
-    uint32_to_binary_string(RCC->PLLCFGR, buff, 33);
-    print_shell("PLLCFGR:  0x%08lX  (%s)\r\n", (unsigned long)RCC->PLLCFGR, buff);
-
-    uint32_to_binary_string(RCC->CFGR, buff, 33);
-    print_shell("CFGR:     0x%08lX  (%s)\r\n", (unsigned long)RCC->CFGR, buff);
-
-    uint32_to_binary_string(RCC->CIR, buff, 33);
-    print_shell("CIR:      0x%08lX  (%s)\r\n", (unsigned long)RCC->CIR, buff);
-
-    uint32_to_binary_string(RCC->AHB1RSTR, buff, 33);
-    print_shell("AHB1RSTR: 0x%08lX  (%s)\r\n", (unsigned long)RCC->AHB1RSTR, buff);
-
-    uint32_to_binary_string(RCC->AHB2RSTR, buff, 33);
-    print_shell("AHB2RSTR: 0x%08lX  (%s)\r\n", (unsigned long)RCC->AHB2RSTR, buff);
-
-    uint32_to_binary_string(RCC->APB1RSTR, buff, 33);
-    print_shell("APB1RSTR: 0x%08lX  (%s)\r\n", (unsigned long)RCC->APB1RSTR, buff);
-
-    uint32_to_binary_string(RCC->APB2RSTR, buff, 33);
-    print_shell("APB2RSTR: 0x%08lX  (%s)\r\n", (unsigned long)RCC->APB2RSTR, buff);
-
-    uint32_to_binary_string(RCC->AHB1ENR, buff, 33);
-    print_shell("AHB1ENR:  0x%08lX  (%s)\r\n", (unsigned long)RCC->AHB1ENR, buff);
-
-    uint32_to_binary_string(RCC->AHB2ENR, buff, 33);
-    print_shell("AHB2ENR:  0x%08lX  (%s)\r\n", (unsigned long)RCC->AHB2ENR, buff);
-
-    uint32_to_binary_string(RCC->APB1ENR, buff, 33);
-    print_shell("APB1ENR:  0x%08lX  (%s)\r\n", (unsigned long)RCC->APB1ENR, buff);
-
-    uint32_to_binary_string(RCC->APB2ENR, buff, 33);
-    print_shell("APB2ENR:  0x%08lX  (%s)\r\n", (unsigned long)RCC->APB2ENR, buff);
+    print_reg("CR:", 10, RCC->CR);
+    print_reg("PLLCFGR:", 10, RCC->PLLCFGR);
+    print_reg("CFGR:", 10, RCC->CFGR);
+    print_reg("CIR:", 10, RCC->CIR);
+    print_reg("AHB1RSTR:", 10, RCC->AHB1RSTR);
+    print_reg("AHB2RSTR:", 10, RCC->AHB2RSTR);
+    print_reg("APB1RSTR:", 10, RCC->APB1RSTR);
+    print_reg("APB2RSTR:", 10, RCC->APB2RSTR);
+    print_reg("AHB1ENR:", 10, RCC->AHB1ENR);
+    print_reg("AHB2ENR:", 10, RCC->AHB2ENR);
+    print_reg("APB1ENR:", 10, RCC->APB1ENR);
+    print_reg("APB2ENR:", 10, RCC->APB2ENR);
 }
 
-void print_timer_status_cmd(char *args) {
+void print_timer_status_cmd(TIM_TypeDef *tim) {
     /*
     === TIM1 Status ===
     Configuration:
@@ -775,6 +1326,7 @@ void print_timer_status_cmd(char *args) {
     */
 
     // TODO: Implementation - High-level timer status
+    (void)tim;
 }
 
 void showreg_timer1() {
@@ -0,0 +1,431 @@
+#include "shell_args.h"
+#include "shell.h"
+#include <string.h>
+#include <strings.h>
+
+#include <stddef.h>
+
+#define REG(type, name, field) { name, offsetof(type, field) }
+#define COUNT(table) (sizeof(table) / sizeof(table[0]))
+
+static const ShellReg_t gpio_regs[] = {
+    REG(GPIO_TypeDef, "afrh", AFR[1]),
+    REG(GPIO_TypeDef, "afrl", AFR[0]),
+    REG(GPIO_TypeDef, "bsrr", BSRR),
+    REG(GPIO_TypeDef, "idr", IDR),
+    REG(GPIO_TypeDef, "lckr", LCKR),
+    REG(GPIO_TypeDef, "moder", MODER),
+    REG(GPIO_TypeDef, "odr", ODR),
+    REG(GPIO_TypeDef, "ospeedr", OSPEEDR),
+    REG(GPIO_TypeDef, "otyper", OTYPER),
+    REG(GPIO_TypeDef, "pupdr", PUPDR),
+};
+
+static const ShellReg_t rcc_regs[] = {
+    REG(RCC_TypeDef, "ahb1enr", AHB1ENR),
+    REG(RCC_TypeDef, "ahb1rstr", AHB1RSTR),
+    REG(RCC_TypeDef, "ahb2enr", AHB2ENR),
+    REG(RCC_TypeDef, "ahb2rstr", AHB2RSTR),
+    REG(RCC_TypeDef, "apb1enr", APB1ENR),
+    REG(RCC_TypeDef, "apb1rstr", APB1RSTR),
+    REG(RCC_TypeDef, "apb2enr", APB2ENR),
+    REG(RCC_TypeDef, "apb2rstr", APB2RSTR),
+    REG(RCC_TypeDef, "bdcr", BDCR),
+    REG(RCC_TypeDef, "cfgr", CFGR),
+    REG(RCC_TypeDef, "cir", CIR),
+    REG(RCC_TypeDef, "cr", CR),
+    REG(RCC_TypeDef, "csr", CSR),
+    REG(RCC_TypeDef, "pllcfgr", PLLCFGR),
+};
+
+static const ShellReg_t tim_regs[] = {
+    REG(TIM_TypeDef, "arr", ARR),
+    REG(TIM_TypeDef, "bdtr", BDTR),
+    REG(TIM_TypeDef, "ccer", CCER),
+    REG(TIM_TypeDef, "ccmr1", CCMR1),
+    REG(TIM_TypeDef, "ccmr2", CCMR2),
+    REG(TIM_TypeDef, "ccr1", CCR1),
+    REG(TIM_TypeDef, "ccr2", CCR2),
+    REG(TIM_TypeDef, "ccr3", CCR3),
+    REG(TIM_TypeDef, "ccr4", CCR4),
+    REG(TIM_TypeDef, "cnt", CNT),
+    REG(TIM_TypeDef, "cr1", CR1),
+    REG(TIM_TypeDef, "cr2", CR2),
+    REG(TIM_TypeDef, "dcr", DCR),
+    REG(TIM_TypeDef, "dier", DIER),
+    REG(TIM_TypeDef, "dmar", DMAR),
+    REG(TIM_TypeDef, "egr", EGR),
+    REG(TIM_TypeDef, "psc", PSC),
+    REG(TIM_TypeDef, "rcr", RCR),
+    REG(TIM_TypeDef, "smcr", SMCR),
+    REG(TIM_TypeDef, "sr", SR),
+};
+
+static const ShellReg_t usart_regs[] = {
+    REG(USART_TypeDef, "brr", BRR),
+    REG(USART_TypeDef, "cr1", CR1),
+    REG(USART_TypeDef, "cr2", CR2),
+    REG(USART_TypeDef, "cr3", CR3),
+    REG(USART_TypeDef, "dr", DR),
+    REG(USART_TypeDef, "gtpr", GTPR),
+    REG(USART_TypeDef, "sr", SR),
+};
+
+const ShellPeriph_t shell_periphs[] = {
+    { "gpioa",  "GPIOA",  PERIPH_GPIO,  GPIOA,  gpio_regs,  COUNT(gpio_regs) },
+    { "gpiob",  "GPIOB",  PERIPH_GPIO,  GPIOB,  gpio_regs,  COUNT(gpio_regs) },
+    { "gpioc",  "GPIOC",  PERIPH_GPIO,  GPIOC,  gpio_regs,  COUNT(gpio_regs) },
+    { "gpiod",  "GPIOD",  PERIPH_GPIO,  GPIOD,  gpio_regs,  COUNT(gpio_regs) },
+    { "rcc",    "RCC",    PERIPH_RCC,   RCC,    rcc_regs,   COUNT(rcc_regs) },
+    { "timer1", "TIM1",   PERIPH_TIM,   TIM1,   tim_regs,   COUNT(tim_regs) },
+    { "uart1",  "USART1", PERIPH_USART, USART1, usart_regs, COUNT(usart_regs) },
+    { "uart2",  "USART2", PERIPH_USART, USART2, usart_regs, COUNT(usart_regs) },
+};
+const size_t shell_periph_count = COUNT(shell_periphs);
+
+int shell_tokenize(char *line, char **argv, uint16_t *starts, int max_args) {
+    /* Quotes and backslashes are removed by shifting the rest of the word
+     * down, so every argument stays inside line and nothing is copied out.
+     */
+    char *src = line;
+    char *dst = line;
+    int argc = 0;
+
+    while (1) {
+        char quote = 0;
+
+        while (*src == ' ' || *src == '\t') src++;
+        if (*src == '\0') {
+            break;
+        }
+        if (argc == max_args) {
+            return SHELL_TOK_ERR_COUNT;
+        }
+        if (starts != NULL) {
+            starts[argc] = (uint16_t)(src - line);
+        }
+        argv[argc++] = dst;
+
+        while (*src != '\0' && (quote || (*src != ' ' && *src != '\t'))) {
+            if (quote && *src == quote) {
+                quote = 0;
+                src++;
+            } else if (!quote && (*src == '"' || *src == '\'')) {
+                quote = *src++;
+            } else if (*src == '\\' && quote != '\'' && src[1] != '\0') {
+                src++;
+                *dst++ = *src++;
+            } else {
+                *dst++ = *src++;
+            }
+        }
+        if (quote) {
+            return SHELL_TOK_ERR_QUOTE;
+        }
+        if (*src != '\0') {
+            src++;
+        }
+        *dst++ = '\0';
+    }
+    return argc;
+}
+
+int shell_parse_u32(const char *s, uint32_t *out) {
+    /* Decimal, 0x hex or 0b binary. '_' may separate digits (as printed by
+     * the %' format), decimal accepts a k (x1000) or M (x1000000) suffix.
+     */
+    uint32_t base = 10;
+    uint64_t v = 0;
+    int digits = 0;
+
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+    } else if (s[0] == '0' && (s[1] == 'b' || s[1] == 'B')) {
+        base = 2;
+        s += 2;
+    }
+
+    for (; *s != '\0'; s++) {
+        uint32_t d;
+
+        if (*s >= '0' && *s <= '9') {
+            d = *s - '0';
+        } else if (base == 16 && *s >= 'a' && *s <= 'f') {
+            d = *s - 'a' + 10;
+        } else if (base == 16 && *s >= 'A' && *s <= 'F') {
+            d = *s - 'A' + 10;
+        } else if (*s == '_' && digits > 0) {
+            continue;
+        } else {
+            break;
+        }
+        if (d >= base) {
+            return -1;
+        }
+        v = v * base + d;
+        if (v > UINT32_MAX) {
+            return -1;
+        }
+        digits++;
+    }
+
+    if (digits == 0) {
+        return -1;
+    }
+    if (base == 10 && (*s == 'k' || *s == 'K')) {
+        v *= 1000;
+        s++;
+    } else if (base == 10 && *s == 'M') {
+        v *= 1000000;
+        s++;
+    }
+    if (*s != '\0' || v > UINT32_MAX) {
+        return -1;
+    }
+
+    *out = (uint32_t)v;
+    return 0;
+}
+
+int shell_parse_word(const char *s, const char *words, size_t words_len) {
+    // words is a '|' separated list, not necessarily NUL terminated
+    const char *end = words + words_len;
+    int index = 0;
+
+    while (words < end) {
+        const char *bar = memchr(words, '|', (size_t)(end - words));
+        size_t n = bar ? (size_t)(bar - words) : (size_t)(end - words);
+
+        if (strncasecmp(s, words, n) == 0 && s[n] == '\0') {
+            return index;
+        }
+        words += n + 1;
+        index++;
+    }
+    return -1;
+}
+
+const ShellPeriph_t* shell_parse_periph(const char *s) {
+    size_t lo = 0;
+    size_t hi = shell_periph_count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int r = strcasecmp(s, shell_periphs[mid].name);
+
+        if (r == 0) {
+            return &shell_periphs[mid];
+        }
+        if (r < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+const ShellReg_t* shell_parse_reg(const ShellPeriph_t *periph, const char *s) {
+    size_t lo = 0;
+    size_t hi = periph->reg_count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int r = strcasecmp(s, periph->regs[mid].name);
+
+        if (r == 0) {
+            return &periph->regs[mid];
+        }
+        if (r < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+const char* shell_spec_element(const char *spec, int index, size_t *len) {
+    // Body of the index-th <...> / [...] element, or NULL past the end
+    while (*spec != '\0') {
+        const char *end;
+
+        while (*spec == ' ') spec++;
+        if (*spec == '\0') {
+            break;
+        }
+        end = strchr(spec + 1, *spec == '<' ? '>' : ']');
+        if (index-- == 0) {
+            *len = (size_t)(end - spec - 1);
+            return spec + 1;
+        }
+        spec = end + 1;
+    }
+    return NULL;
+}
+
+static void print_usage(const char *cmd, const char *spec) {
+    print_shell("Usage: %s%s%s\r\n", cmd, spec[0] ? " " : "", spec);
+}
+
+/* expected_len < 0 prints the whole of expected. With expected NULL the
+ * valid names are listed instead: the registers of periph, or all
+ * peripherals when periph is NULL too.
+ */
+static void bind_error(const char *cmd, const char *spec, const char *tok, const char *expected,
+                       int expected_len, const ShellPeriph_t *periph) {
+    print_shell("%s: invalid argument '%s', expected ", cmd, tok);
+    if (expected != NULL) {
+        print_shell("%.*s", expected_len, expected);
+    } else if (periph != NULL) {
+        for (size_t i = 0; i < periph->reg_count; i++) {
+            print_shell("%s%s", i ? "|" : "", periph->regs[i].name);
+        }
+    } else {
+        for (size_t i = 0; i < shell_periph_count; i++) {
+            print_shell("%s%s", i ? "|" : "", shell_periphs[i].name);
+        }
+    }
+    print_shell("\r\n");
+    print_usage(cmd, spec);
+}
+
+static int too_many_args(const char *cmd, const char *spec) {
+    print_shell("%s: too many arguments\r\n", cmd);
+    print_usage(cmd, spec);
+    return -1;
+}
+
+int shell_args_bind(const char *cmd, const char *spec, int tokc, char **tokv, const char *const *rawv,
+                    ShellArg_t *argv) {
+    const char *p = spec;
+    int argc = 1;
+    int t = 1;
+
+    memset(argv, 0, sizeof(ShellArg_t) * SHELL_MAX_ARGS);
+    argv[0].str = tokv[0];
+
+    while (*p != '\0') {
+        const char *body;
+        const char *end;
+        const char *colon;
+        size_t len;
+        char open;
+
+        while (*p == ' ') p++;
+        if (*p == '\0') {
+            break;
+        }
+
+        // Specs are written by us, so a well-formed <...> / [...] is assumed
+        open = *p;
+        body = p + 1;
+        end = strchr(body, open == '<' ? '>' : ']');
+        len = (size_t)(end - body);
+        colon = memchr(body, ':', len);
+
+        if (t >= tokc) {
+            if (open == '<') {
+                print_shell("%s: missing argument %.*s\r\n", cmd, (int)(end + 1 - p), p);
+                print_usage(cmd, spec);
+                return -1;
+            }
+            p = end + 1;        // absent optional, but a required element may still follow
+            continue;
+        }
+        p = end + 1;
+
+        // Skipped optional words keep their slot, so argc can outrun the tokens
+        if (argc >= SHELL_MAX_ARGS) {
+            return too_many_args(cmd, spec);
+        }
+
+        if (len >= 3 && memcmp(end - 3, "...", 3) == 0) {
+            while (t < tokc) {
+                if (argc >= SHELL_MAX_ARGS) {
+                    return too_many_args(cmd, spec);
+                }
+                argv[argc].raw = rawv != NULL ? rawv[t] : NULL;
+                argv[argc++].str = tokv[t++];
+            }
+            break;
+        }
+
+        argv[argc].str = tokv[t];
+        argv[argc].raw = rawv != NULL ? rawv[t] : NULL;
+        if (colon != NULL && end - colon == 4 && memcmp(colon + 1, "int", 3) == 0) {
+            if (shell_parse_u32(tokv[t], &argv[argc].num) != 0) {
+                bind_error(cmd, spec, tokv[t], "a number (123, 0x7B, 0b1111011, 115k)", -1, NULL);
+                return -1;
+            }
+        } else if (colon != NULL) {
+            // :str, taken as is
+        } else if (len == 3 && memcmp(body, "reg", 3) == 0) {
+            const ShellPeriph_t *periph = argv[argc - 1].periph;
+            argv[argc].reg = periph ? shell_parse_reg(periph, tokv[t]) : NULL;
+            if (argv[argc].reg == NULL) {
+                bind_error(cmd, spec, tokv[t], NULL, 0, periph);
+                return -1;
+            }
+        } else if (len == 6 && memcmp(body, "periph", 6) == 0) {
+            argv[argc].periph = shell_parse_periph(tokv[t]);
+            if (argv[argc].periph == NULL) {
+                bind_error(cmd, spec, tokv[t], NULL, 0, NULL);
+                return -1;
+            }
+        } else {
+            argv[argc].index = shell_parse_word(tokv[t], body, len);
+            if (argv[argc].index < 0 && open == '[' && p[strspn(p, " ")] != '\0') {
+                // An optional word that does not match is absent if more follows: "[-v] <pattern:str>"
+                argv[argc].str = NULL;
+                argv[argc].raw = NULL;
+                argc++;
+                continue;
+            }
+            if (argv[argc].index < 0) {
+                bind_error(cmd, spec, tokv[t], body, (int)len, NULL);
+                return -1;
+            }
+        }
+        argc++;
+        t++;
+    }
+
+    if (t < tokc) {
+        return too_many_args(cmd, spec);
+    }
+    return argc;
+}
+
+/* The command line in argv[first..argc), for commands that run another
+ * command: the rest of the line as typed, so quoting survives the second
+ * parse. A single argument is taken unquoted instead, which makes a quoted
+ * "cmd | filter" one command line with its own pipeline. Returns the length,
+ * or -1 if there is no command or it does not fit.
+ */
+int shell_args_rest(int argc, ShellArg_t *argv, int first, char *out, size_t size) {
+    const char *text;
+    size_t len;
+
+    if (first >= argc || argv[first].str == NULL) {
+        return -1;
+    }
+    if (argc - first == 1) {
+        text = argv[first].str;
+        len = strlen(text);
+    } else {
+        if (argv[first].raw == NULL) {
+            return -1;
+        }
+        text = argv[first].raw;
+        len = strlen(text);
+    }
+
+    if (len >= size) {
+        return -1;
+    }
+    memcpy(out, text, len);
+    out[len] = '\0';
+    return (int)len;
+}
@@ -0,0 +1,162 @@
+#include "shell_bench.h"
+#include "shell.h"
+#include "shell_cmd.h"
+#include "shell_jobs.h"
+#include "uart_driver.h"
+#include "dwt.h"
+#include <string.h>
+
+// Keys as a VT100 terminal sends them; Enter is '\n' as the RX path delivers it
+#define KEY_UP          "\033[A"
+#define KEY_DOWN        "\033[B"
+#define KEY_RIGHT       "\033[C"
+#define KEY_LEFT        "\033[D"
+#define KEY_HOME        "\033[H"
+#define KEY_END         "\033[F"
+#define KEY_DELETE      "\033[3~"
+#define KEY_CTRL_LEFT   "\033[1;5D"
+#define KEY_CTRL_RIGHT  "\033[1;5C"
+
+#define PASTE_TEXT      "the quick brown fox jumps over the lazy dog 0123456789 "
+
+typedef struct {
+    const char *name;
+    const char *keys;
+    const char *const *history;
+} ShellBenchScenario_t;
+
+static const char *const bench_history[] = {
+    "showreg gpioa odr",
+    "echo one two three",
+    "status gpioa",
+    "showreg rcc cfgr",
+    "help",
+    NULL
+};
+
+static const ShellBenchScenario_t bench_scenarios[] = {
+    // Commands typed one key at a time and run, output included
+    { "type",
+      "echo hello world\n"
+      "showreg gpioa odr\n"
+      "status uart2 | grep baud\n"
+      "history\n",
+      NULL },
+    // Up/Down through the history, edit the recalled line, Ctrl+R and accept
+    { "history",
+      KEY_UP KEY_UP KEY_UP KEY_UP KEY_UP KEY_DOWN KEY_DOWN KEY_UP
+      "\x05 x" KEY_DOWN KEY_UP KEY_UP
+      "\x12" "gpi" "\x12" KEY_END "\x15",
+      bench_history },
+    // Paste at the end, then twice into the middle, which redraws the tail each time
+    { "paste",
+      "echo " PASTE_TEXT
+      "\x01" KEY_RIGHT KEY_RIGHT KEY_RIGHT KEY_RIGHT KEY_RIGHT PASTE_TEXT
+      "\x15",
+      NULL },
+    // Cursor, word and delete keys, plus sequences the decoder has to drop whole
+    { "escape",
+      "showreg gpioa moder"
+      KEY_LEFT KEY_LEFT KEY_LEFT KEY_LEFT KEY_LEFT KEY_CTRL_LEFT KEY_CTRL_LEFT KEY_HOME
+      KEY_CTRL_RIGHT KEY_RIGHT KEY_DELETE KEY_DELETE KEY_END "\033OH" "\033OF"
+      "\033[15~" "\033[1;2P" "\033[<0;12;5M" "\033b" "\033f" "\033[?25h" "\033[200~"
+      KEY_LEFT KEY_RIGHT KEY_LEFT KEY_RIGHT "\033[201~" "\x15",
+      NULL },
+    // Completion of command, peripheral and register names, and a candidate list
+    { "tab",
+      "sh\tgp\tmo\t\x15" "st\tu\t\t\x15" "s\t\t\x15",
+      NULL },
+    // Half-typed commands abandoned with Ctrl+C, and Ctrl+C on an empty line
+    { "ctrlc",
+      "showreg gpi\x03" "echo abc def\x03" "\x03" "\x03",
+      NULL },
+};
+
+static void count_sink(void *ctx, const char *data, size_t len) {
+    (void)data;
+    *(uint32_t *)ctx += (uint32_t)len;
+}
+
+void shell_bench_replay(const uint8_t *data, size_t len, const char *const *history, ShellBenchResult_t *r) {
+    fmt_write_fn out;
+    void *out_ctx;
+    uint32_t out_bytes = 0;
+    uint32_t start;
+
+    shell_replay_begin();
+    while (history != NULL && *history != NULL) {
+        shell_history_add(&cmd_history_buffer, *history, strlen(*history));
+        history++;
+    }
+    shell_get_output(&out, &out_ctx);
+    shell_set_output(count_sink, &out_bytes);
+
+    DWT_Enable();
+    start = DWT_GetCycles();
+    for (size_t i = 0; i < len; i++) {
+        process_char(data[i]);
+    }
+    r->cycles += DWT_GetCycles() - start;
+
+    shell_set_output(out, out_ctx);
+    shell_replay_end();
+
+    r->runs++;
+    r->in_bytes += (uint32_t)len;
+    r->out_bytes += out_bytes;
+}
+
+void shell_bench_header(uint32_t runs) {
+    print_shell("Input path, %lu runs each, %lu MHz, wire time at %lu baud:\r\n", (unsigned long)runs,
+                (unsigned long)(SystemCoreClock / 1000000u), (unsigned long)UART_GetBaud());
+    print_shell("  scenario    in B    cyc/B     ns/B   out/in   wire us/B\r\n");
+}
+
+void shell_bench_print(const char *name, const ShellBenchResult_t *r) {
+    uint64_t in = r->in_bytes;
+    uint64_t out = r->out_bytes;
+    uint32_t baud = UART_GetBaud();
+    uint32_t mhz = SystemCoreClock / 1000000u;
+
+    if (in == 0 || baud == 0 || mhz == 0) {
+        print_shell("  %-10s no input\r\n", name);
+        return;
+    }
+
+    // out/in in hundredths, wire time in tenths of a microsecond (10 bits a byte)
+    print_shell("  %-10s %5lu %8llu %8llu %5llu.%02llu %9llu.%llu\r\n", name,
+                (unsigned long)(r->in_bytes / r->runs),
+                (unsigned long long)(r->cycles / in),
+                (unsigned long long)(r->cycles * 1000u / mhz / in),
+                (unsigned long long)(out / in), (unsigned long long)(out * 100u / in % 100u),
+                (unsigned long long)(out * 100000000u / in / baud / 10u),
+                (unsigned long long)(out * 100000000u / in / baud % 10u));
+}
+
+static void keybench_cmd(int argc, ShellArg_t *argv) {
+    uint32_t runs = argc > 1 ? argv[1].num : SHELL_BENCH_RUNS;
+
+    // The replay borrows the shell task's line editor, which a job cannot share
+    if (shell_in_background()) {
+        print_shell("keybench: foreground only\r\n");
+        return;
+    }
+    if (runs == 0) {
+        runs = 1;
+    }
+
+    shell_bench_header(runs);
+    for (size_t i = 0; i < sizeof(bench_scenarios) / sizeof(bench_scenarios[0]); i++) {
+        const ShellBenchScenario_t *s = &bench_scenarios[i];
+        ShellBenchResult_t r = { 0 };
+
+        for (uint32_t run = 0; run < runs && !shell_cancelled(); run++) {
+            shell_bench_replay((const uint8_t *)s->keys, strlen(s->keys), s->history, &r);
+        }
+        if (shell_cancelled()) {
+            return;
+        }
+        shell_bench_print(s->name, &r);
+    }
+}
+SHELL_COMMAND(keybench, keybench_cmd, "[runs:int]", "Replay keystroke streams, report cycles and output per input byte");
@@ -0,0 +1,71 @@
+#include "shell_cmd.h"
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+// Provided by the linker script around the sorted .shell_cmd.* sections
+extern const ShellCommand_t __shell_cmd_start[];
+extern const ShellCommand_t __shell_cmd_end[];
+
+/* strcmp() order between the first len chars of name, ignoring case, and a
+ * NUL-terminated entry name; entry names are lower case (shell_cmd_verify),
+ * so this is also their linker order.
+ */
+static int cmd_compare(const char *name, size_t len, const char *entry) {
+    int r = strncasecmp(name, entry, len);
+
+    if (r == 0 && entry[len] != '\0') {
+        return -1;      // name is a proper prefix of entry, so it sorts first
+    }
+    return r;
+}
+
+const ShellCommand_t* shell_cmd_find(const char *name, size_t len) {
+    size_t lo = 0;
+    size_t hi = shell_cmd_count();
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int r = cmd_compare(name, len, __shell_cmd_start[mid].name);
+
+        if (r == 0) {
+            return &__shell_cmd_start[mid];
+        }
+        if (r < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+const ShellCommand_t* shell_cmd_begin(void) {
+    return __shell_cmd_start;
+}
+
+const ShellCommand_t* shell_cmd_end(void) {
+    return __shell_cmd_end;
+}
+
+size_t shell_cmd_count(void) {
+    return (size_t)(__shell_cmd_end - __shell_cmd_start);
+}
+
+int shell_cmd_verify(void) {
+    // The binary search relies on the linker's SORT_BY_NAME; catch a script that lost it
+    for (const ShellCommand_t *cmd = __shell_cmd_start + 1; cmd < __shell_cmd_end; cmd++) {
+        if (strcmp(cmd[-1].name, cmd->name) >= 0) {
+            return -1;
+        }
+    }
+    // Lookup and completion both fold what was typed to lower case
+    for (const ShellCommand_t *cmd = __shell_cmd_start; cmd < __shell_cmd_end; cmd++) {
+        for (const char *c = cmd->name; *c != '\0'; c++) {
+            if (isupper((unsigned char)*c)) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
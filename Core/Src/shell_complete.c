@@ -0,0 +1,320 @@
+#include "shell_complete.h"
+#include "shell_cmd.h"
+#include "shell_args.h"
+#include "shell.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
+const char* shell_name_at(const ShellNameTable_t *table, size_t index) {
+    return *(const char *const *)((const char *)table->base + index * table->stride);
+}
+
+/* Radix trie node. The names under a node are the range [lo, hi) of its
+ * sorted table and share their first depth characters; the edge label into
+ * the node is that stretch of name lo, read from flash, so nodes hold no
+ * characters. Index 0 is the first root and never a child, so it doubles
+ * as "none".
+ */
+typedef struct {
+    uint8_t lo;
+    uint8_t hi;
+    uint8_t depth;
+    uint8_t child;      // first child
+    uint8_t sibling;    // next child of the same parent
+} ShellTrieNode_t;
+
+_Static_assert(SHELL_TRIE_NODES <= UINT8_MAX, "trie node indices are 8-bit");
+
+static ShellTrieNode_t trie_nodes[SHELL_TRIE_NODES];
+static size_t trie_used;
+
+// Tries built so far, by table; root -1 when the table did not fit
+static struct {
+    const void *base;
+    int16_t root;
+} tries[SHELL_TRIE_TABLES];
+static size_t trie_count;
+
+// Node over [lo, hi), with one child per run of names sharing the next character
+static int trie_build(const ShellNameTable_t *table, size_t lo, size_t hi) {
+    const char *first = shell_name_at(table, lo);
+    const char *last = shell_name_at(table, hi - 1);
+    uint8_t *link;
+    size_t depth = 0;
+    size_t node;
+
+    if (trie_used == SHELL_TRIE_NODES) {
+        return -1;
+    }
+    // Sorted: what the first and last names share, all of them share
+    while (first[depth] != '\0' && first[depth] == last[depth]) {
+        depth++;
+    }
+    node = trie_used++;
+    trie_nodes[node] = (ShellTrieNode_t){ (uint8_t)lo, (uint8_t)hi, (uint8_t)depth, 0, 0 };
+
+    link = &trie_nodes[node].child;
+    for (size_t i = lo; i < hi; ) {
+        unsigned char c = (unsigned char)shell_name_at(table, i)[depth];
+        size_t j = i + 1;
+        int child;
+
+        while (j < hi && (unsigned char)shell_name_at(table, j)[depth] == c) {
+            j++;
+        }
+        if (c != '\0') {       // a name ending here needs no node of its own
+            if ((child = trie_build(table, i, j)) < 0) {
+                return -1;
+            }
+            *link = (uint8_t)child;
+            link = &trie_nodes[child].sibling;
+        }
+        i = j;
+    }
+    return (int)node;
+}
+
+// The table's trie, built on first use; -1 if the pool cannot hold it
+static int trie_root(const ShellNameTable_t *table) {
+    size_t mark = trie_used;
+    int root = -1;
+
+    for (size_t i = 0; i < trie_count; i++) {
+        if (tries[i].base == table->base) {
+            return tries[i].root;
+        }
+    }
+    if (table->count > 0 && table->count <= UINT8_MAX) {
+        root = trie_build(table, 0, table->count);
+    }
+    if (root < 0) {
+        trie_used = mark;
+    }
+    if (trie_count < SHELL_TRIE_TABLES) {
+        tries[trie_count].base = table->base;
+        tries[trie_count++].root = (int16_t)root;
+    }
+    return root;
+}
+
+// Fallback for a table without a trie: narrow [lo, hi) by binary search at each depth
+static size_t range_search(const ShellNameTable_t *table, const char *prefix, size_t len, size_t *first) {
+    /* All names in [lo, hi) share the first d characters, so their d-th
+     * characters are sorted too: narrow to the run matching prefix[d].
+     */
+    size_t lo = 0;
+    size_t hi = table->count;
+
+    for (size_t d = 0; d < len && lo < hi; d++) {
+        unsigned char c = (unsigned char)tolower((unsigned char)prefix[d]);
+        size_t a = lo;
+        size_t b = hi;
+
+        while (a < b) {
+            size_t mid = a + (b - a) / 2;
+            if ((unsigned char)shell_name_at(table, mid)[d] < c) {
+                a = mid + 1;
+            } else {
+                b = mid;
+            }
+        }
+        lo = a;
+
+        b = hi;
+        while (a < b) {
+            size_t mid = a + (b - a) / 2;
+            if ((unsigned char)shell_name_at(table, mid)[d] <= c) {
+                a = mid + 1;
+            } else {
+                b = mid;
+            }
+        }
+        hi = a;
+    }
+
+    *first = lo;
+    return lo < hi ? hi - lo : 0;
+}
+
+size_t shell_complete_range(const ShellNameTable_t *table, const char *prefix, size_t len, size_t *first) {
+    int node = trie_root(table);
+    size_t d = 0;
+
+    if (node < 0) {
+        return range_search(table, prefix, len, first);
+    }
+    while (1) {
+        const ShellTrieNode_t *n = &trie_nodes[node];
+        const char *name = shell_name_at(table, n->lo);
+        unsigned char c;
+
+        // Along the edge: one compare per character
+        for (; d < len && d < n->depth; d++) {
+            if ((unsigned char)name[d] != (unsigned char)tolower((unsigned char)prefix[d])) {
+                return 0;
+            }
+        }
+        if (d == len) {
+            *first = n->lo;
+            return (size_t)(n->hi - n->lo);
+        }
+
+        // Branch: the children differ in character d, so at most one matches
+        c = (unsigned char)tolower((unsigned char)prefix[d]);
+        for (node = n->child; node != 0; node = trie_nodes[node].sibling) {
+            if ((unsigned char)shell_name_at(table, trie_nodes[node].lo)[d] == c) {
+                break;
+            }
+        }
+        if (node == 0) {
+            return 0;
+        }
+    }
+}
+
+// Bounds of the index-th blank separated word of line[0..len); returns 0 if there is none
+static int word_at(const char *line, int len, int index, int *start, int *end) {
+    int i = 0;
+
+    while (1) {
+        while (i < len && (line[i] == ' ' || line[i] == '\t')) i++;
+        if (i == len) {
+            return 0;
+        }
+        *start = i;
+        while (i < len && line[i] != ' ' && line[i] != '\t') i++;
+        *end = i;
+        if (index-- == 0) {
+            return 1;
+        }
+    }
+}
+
+// Pick the name table for the word_index-th word of the line
+static int candidates_for(const char *line, int len, int word_index, ShellNameTable_t *table) {
+    const ShellCommand_t *cmd;
+    const ShellPeriph_t *periph;
+    const char *elem;
+    size_t elem_len;
+    char name[16];
+    int start;
+    int end;
+
+    if (word_index == 0) {
+        table->base = shell_cmd_begin();
+        table->stride = sizeof(ShellCommand_t);
+        table->count = shell_cmd_count();
+        return 1;
+    }
+
+    word_at(line, len, 0, &start, &end);
+    cmd = shell_cmd_find(line + start, (size_t)(end - start));
+    if (cmd == NULL || (elem = shell_spec_element(cmd->args, word_index - 1, &elem_len)) == NULL) {
+        return 0;
+    }
+
+    if (elem_len == 6 && memcmp(elem, "periph", 6) == 0) {
+        table->base = shell_periphs;
+        table->stride = sizeof(ShellPeriph_t);
+        table->count = shell_periph_count;
+        return 1;
+    }
+
+    if (elem_len == 3 && memcmp(elem, "reg", 3) == 0) {
+        // Registers of the peripheral named by the previous word
+        word_at(line, len, word_index - 1, &start, &end);
+        if (end - start >= (int)sizeof(name)) {
+            return 0;
+        }
+        memcpy(name, line + start, (size_t)(end - start));
+        name[end - start] = '\0';
+        if ((periph = shell_parse_periph(name)) == NULL) {
+            return 0;
+        }
+        table->base = periph->regs;
+        table->stride = sizeof(ShellReg_t);
+        table->count = periph->reg_count;
+        return 1;
+    }
+    return 0;
+}
+
+static void list_candidates(const ShellNameTable_t *table, size_t first, size_t count) {
+    size_t width = 0;
+    size_t col = 0;
+    size_t columns = shell_term_width();
+
+    for (size_t i = first; i < first + count; i++) {
+        size_t n = strlen(shell_name_at(table, i));
+        if (n > width) {
+            width = n;
+        }
+    }
+    width += 2;
+
+    print_shell("\r\n");
+    for (size_t i = first; i < first + count; i++) {
+        if (col + width > columns && col > 0) {
+            print_shell("\r\n");
+            col = 0;
+        }
+        print_shell("%-*s", (int)width, shell_name_at(table, i));
+        col += width;
+    }
+    print_shell("\r\n");
+}
+
+int shell_complete(const char *line, int len, char *out, int size, int list) {
+    ShellNameTable_t table;
+    const char *lo_name;
+    const char *hi_name;
+    size_t first;
+    size_t count;
+    int start = len;
+    int word_index = 0;
+    int s;
+    int e;
+    int k;
+    int added;
+
+    while (start > 0 && line[start - 1] != ' ' && line[start - 1] != '\t') {
+        start--;
+    }
+    while (word_at(line, start, word_index, &s, &e)) {
+        word_index++;
+    }
+
+    if (!candidates_for(line, start, word_index, &table)) {
+        return 0;
+    }
+    count = shell_complete_range(&table, line + start, (size_t)(len - start), &first);
+    if (count == 0) {
+        return 0;
+    }
+
+    // Sorted range: its common prefix is the common prefix of the first and last name
+    lo_name = shell_name_at(&table, first);
+    hi_name = shell_name_at(&table, first + count - 1);
+    k = len - start;
+    while (lo_name[k] != '\0' && lo_name[k] == hi_name[k]) {
+        k++;
+    }
+
+    added = 0;
+    for (int i = len - start; i < k && added < size; i++) {
+        out[added++] = lo_name[i];
+    }
+    if (count == 1 && added < size) {
+        out[added++] = ' ';
+    }
+    if (added > 0) {
+        return added;
+    }
+
+    if (list && count > 1) {
+        list_candidates(&table, first, count);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "shell_history.h"
+#include "ring_buffer.h"
+
+#define ARENA_MASK (HISTORY_ARENA_SIZE - 1)
+
+_Static_assert(RING_IS_POW2(HISTORY_ARENA_SIZE), "HISTORY_ARENA_SIZE must be a power of two");
+_Static_assert(HISTORY_MAX_ENTRY + 2 <= HISTORY_ARENA_SIZE, "HISTORY_ARENA_SIZE too small");
+
+static inline uint8_t arena_at(const CommandHistory_t *history, uint32_t pos) {
+    return history->arena[pos & ARENA_MASK];
+}
+
+static inline uint32_t entry_len(const CommandHistory_t *history, uint32_t pos) {
+    return arena_at(history, pos);
+}
+
+static uint32_t older(const CommandHistory_t *history, uint32_t pos) {
+    // pos (an entry start, or head) is also where the older entry ends, after its trailing length byte
+    return pos - 2 - arena_at(history, pos - 1);
+}
+
+uint32_t shell_history_newer(const CommandHistory_t *history, uint32_t pos) {
+    return pos + 2 + entry_len(history, pos);
+}
+
+size_t shell_history_read(const CommandHistory_t *history, uint32_t pos, char *out, size_t size) {
+    size_t len = entry_len(history, pos);
+
+    if (len > size - 1) {
+        len = size - 1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        out[i] = (char)arena_at(history, pos + 1 + i);
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static int entry_equals(const CommandHistory_t *history, uint32_t pos, const char *cmd, size_t len) {
+    if (entry_len(history, pos) != len) {
+        return 0;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (arena_at(history, pos + 1 + i) != (uint8_t)cmd[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void shell_history_add(CommandHistory_t *history, const char *cmd, size_t len) {
+    uint32_t need = (uint32_t)len + 2;
+
+    history->cursor = history->head;
+    if (len == 0 || len > HISTORY_MAX_ENTRY) {
+        return;
+    }
+    if (history->count > 0 && entry_equals(history, older(history, history->head), cmd, len)) {
+        return;
+    }
+
+    while (HISTORY_ARENA_SIZE - (history->head - history->tail) < need) {
+        history->tail = shell_history_newer(history, history->tail);
+        history->count--;
+    }
+
+    history->arena[history->head & ARENA_MASK] = (uint8_t)len;
+    for (size_t i = 0; i < len; i++) {
+        history->arena[(history->head + 1 + i) & ARENA_MASK] = (uint8_t)cmd[i];
+    }
+    history->arena[(history->head + 1 + len) & ARENA_MASK] = (uint8_t)len;
+
+    history->head += need;
+    history->cursor = history->head;
+    history->count++;
+    history->total++;
+}
+
+void shell_history_clear(CommandHistory_t *history) {
+    history->tail = history->head;
+    history->cursor = history->head;
+    history->count = 0;
+}
+
+int shell_history_prev(CommandHistory_t *history, char *out, size_t size) {
+    if (history->cursor == history->tail) {
+        return -1;
+    }
+    history->cursor = older(history, history->cursor);
+    return (int)shell_history_read(history, history->cursor, out, size);
+}
+
+int shell_history_next(CommandHistory_t *history, char *out, size_t size) {
+    if (history->cursor == history->head) {
+        return -1;
+    }
+    history->cursor = shell_history_newer(history, history->cursor);
+    if (history->cursor == history->head) {
+        out[0] = '\0';
+        return 0;
+    }
+    return (int)shell_history_read(history, history->cursor, out, size);
+}
+
+static int entry_contains(const CommandHistory_t *history, uint32_t pos, const char *pattern, size_t len) {
+    size_t n = entry_len(history, pos);
+
+    for (size_t start = 0; start + len <= n; start++) {
+        size_t i = 0;
+
+        while (i < len && arena_at(history, pos + 1 + start + i) == (uint8_t)pattern[i]) {
+            i++;
+        }
+        if (i == len) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int shell_history_search(const CommandHistory_t *history, uint32_t *pos, const char *pattern, size_t len) {
+    uint32_t p = *pos;
+
+    while (p != history->tail) {
+        p = older(history, p);
+        if (entry_contains(history, p, pattern, len)) {
+            *pos = p;
+            return 1;
+        }
+    }
+    return 0;
+}
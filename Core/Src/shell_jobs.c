@@ -0,0 +1,195 @@
+#include "shell_jobs.h"
+#include "shell.h"
+#include "shell_cmd.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <string.h>
+
+#define FG_POLL_MS 10
+
+typedef enum {
+    JOB_FREE,
+    JOB_RUNNING,
+    JOB_DONE                            // finished, not reported yet
+} ShellJobState_t;
+
+typedef struct {
+    TaskHandle_t task;
+    volatile uint8_t state;
+    uint8_t id;
+    TickType_t started;
+    char line[CMD_BUFFER_SIZE];         // as typed, for jobs / Done
+    char scratch[CMD_BUFFER_SIZE];      // process_command() tokenizes in place
+    ShellContext_t ctx;
+} ShellJob_t;
+
+static ShellContext_t foreground;
+static ShellJob_t jobs[SHELL_JOB_WORKERS];
+static uint8_t next_id = 1;
+
+ShellContext_t* shell_context(void) {
+    ShellContext_t *ctx = pvTaskGetThreadLocalStoragePointer(NULL, SHELL_TLS_CONTEXT);
+    return ctx != NULL ? ctx : &foreground;
+}
+
+int shell_cancelled(void) {
+    return shell_context()->cancel;
+}
+
+int shell_in_background(void) {
+    return shell_context() != &foreground;
+}
+
+void shell_interrupt(void) {
+    foreground.cancel = 1;
+}
+
+static void job_worker(void *pvParameters) {
+    ShellJob_t *job = pvParameters;
+
+    vTaskSetThreadLocalStoragePointer(NULL, SHELL_TLS_CONTEXT, &job->ctx);
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        process_command(job->scratch);
+        job->state = JOB_DONE;
+        shell_wake();                   // the shell task reports it
+    }
+}
+
+void shell_jobs_init(void) {
+    for (int i = 0; i < SHELL_JOB_WORKERS; i++) {
+        jobs[i].state = JOB_FREE;
+        xTaskCreate(job_worker, "JOB", SHELL_JOB_STACK_WORDS, &jobs[i], SHELL_JOB_PRIORITY, &jobs[i].task);
+    }
+}
+
+int shell_job_start(const char *command) {
+    for (int i = 0; i < SHELL_JOB_WORKERS; i++) {
+        ShellJob_t *job = &jobs[i];
+        size_t len = strlen(command);
+
+        if (job->state != JOB_FREE || job->task == NULL) {
+            continue;
+        }
+        if (len >= sizeof(job->line)) {
+            len = sizeof(job->line) - 1;
+        }
+        memcpy(job->line, command, len);
+        job->line[len] = '\0';
+        memcpy(job->scratch, job->line, len + 1);
+
+        job->ctx.out = NULL;
+        job->ctx.out_ctx = NULL;
+        job->ctx.cancel = 0;
+        job->id = next_id++;
+        if (next_id == 0) {
+            next_id = 1;
+        }
+        job->started = xTaskGetTickCount();
+        job->state = JOB_RUNNING;
+
+        print_shell("[%u] %s\r\n", job->id, job->line);
+        xTaskNotifyGive(job->task);
+        return job->id;
+    }
+    print_shell("all %d job workers are busy\r\n", SHELL_JOB_WORKERS);
+    return -1;
+}
+
+int shell_jobs_poll(void) {
+    int reported = 0;
+
+    for (int i = 0; i < SHELL_JOB_WORKERS; i++) {
+        ShellJob_t *job = &jobs[i];
+
+        if (job->state == JOB_DONE) {
+            print_shell("\r[%u] %s  %s\033[K\r\n", job->id, job->ctx.cancel ? "Cancelled" : "Done", job->line);
+            job->state = JOB_FREE;
+            reported++;
+        }
+    }
+    return reported;
+}
+
+// "%2", "2", or NULL for the most recent running job
+static ShellJob_t* find_job(const char *arg) {
+    ShellJob_t *found = NULL;
+    uint32_t id = 0;
+
+    if (arg != NULL && shell_parse_u32(arg[0] == '%' ? arg + 1 : arg, &id) != 0) {
+        return NULL;
+    }
+    for (int i = 0; i < SHELL_JOB_WORKERS; i++) {
+        ShellJob_t *job = &jobs[i];
+
+        if (job->state != JOB_RUNNING) {
+            continue;
+        }
+        if (arg != NULL ? job->id == id : (found == NULL || (uint8_t)(job->id - found->id) < 128)) {
+            found = job;
+        }
+    }
+    return found;
+}
+
+static void jobs_cmd(int argc, ShellArg_t *argv) {
+    TickType_t now = xTaskGetTickCount();
+    int listed = 0;
+
+    (void)argc;
+    (void)argv;
+
+    for (int i = 0; i < SHELL_JOB_WORKERS; i++) {
+        ShellJob_t *job = &jobs[i];
+
+        if (job->state == JOB_FREE) {
+            continue;
+        }
+        print_shell("[%u] %-9s %7lu ms  %s\r\n", job->id,
+                    job->state == JOB_DONE ? "Done" : job->ctx.cancel ? "Stopping" : "Running",
+                    (unsigned long)((now - job->started) * portTICK_PERIOD_MS), job->line);
+        listed++;
+    }
+    if (listed == 0) {
+        print_shell("no jobs\r\n");
+    }
+}
+SHELL_COMMAND(jobs, jobs_cmd, "", "List background jobs");
+
+static void fg_cmd(int argc, ShellArg_t *argv) {
+    ShellJob_t *job;
+
+    if (shell_in_background()) {
+        print_shell("fg: not from a background job\r\n");
+        return;
+    }
+    job = find_job(argc > 1 ? argv[1].str : NULL);
+    if (job == NULL) {
+        print_shell("fg: no such job\r\n");
+        return;
+    }
+    print_shell("%s\r\n", job->line);
+
+    // Wait for it here; Ctrl+C reaches us through the RX path and is passed on
+    while (job->state == JOB_RUNNING) {
+        if (shell_cancelled()) {
+            job->ctx.cancel = 1;
+        }
+        vTaskDelay(pdMS_TO_TICKS(FG_POLL_MS));
+    }
+}
+SHELL_COMMAND(fg, fg_cmd, "[job:str]", "Wait for a background job (Ctrl+C cancels it)");
+
+static void kill_cmd(int argc, ShellArg_t *argv) {
+    ShellJob_t *job = find_job(argv[1].str);
+
+    (void)argc;
+
+    if (job == NULL) {
+        print_shell("kill: no such job: %s\r\n", argv[1].str);
+        return;
+    }
+    job->ctx.cancel = 1;
+    print_shell("[%u] cancel requested\r\n", job->id);
+}
+SHELL_COMMAND(kill, kill_cmd, "<job:str>", "Cancel a background job");
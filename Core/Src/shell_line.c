@@ -0,0 +1,141 @@
+#include "shell_line.h"
+#include "shell.h"
+#include <string.h>
+
+// Cursor moves up to this many columns are cheaper as plain bytes than as CSI n D / CSI n C
+#define LINE_SHORT_MOVE 3
+
+static void emit_back(int n) {
+    if (n <= 0) {
+        return;
+    }
+    if (n <= LINE_SHORT_MOVE) {
+        print_shell("%.*s", n, "\b\b\b");
+    } else {
+        print_shell("\033[%dD", n);
+    }
+}
+
+// Move right over line->buf[from..from+n), which is already on screen
+static void emit_forward(const ShellLine_t *line, int from, int n) {
+    if (n <= 0) {
+        return;
+    }
+    if (n <= LINE_SHORT_MOVE) {
+        print_shell("%.*s", n, line->buf + from);
+    } else {
+        print_shell("\033[%dC", n);
+    }
+}
+
+void shell_line_reset(ShellLine_t *line) {
+    line->len = 0;
+    line->cursor = 0;
+    line->buf[0] = '\0';
+}
+
+void shell_line_move(ShellLine_t *line, int pos) {
+    if (pos < 0) {
+        pos = 0;
+    }
+    if (pos > line->len) {
+        pos = line->len;
+    }
+    if (pos < line->cursor) {
+        emit_back(line->cursor - pos);
+    } else {
+        emit_forward(line, line->cursor, pos - line->cursor);
+    }
+    line->cursor = pos;
+}
+
+void shell_line_insert(ShellLine_t *line, const char *s, int n) {
+    int tail = line->len - line->cursor;
+    int room = line->size - 1 - line->len;
+
+    if (n > room) {
+        n = room;
+    }
+    if (n <= 0) {
+        return;
+    }
+
+    memmove(line->buf + line->cursor + n, line->buf + line->cursor, (size_t)tail);
+    memcpy(line->buf + line->cursor, s, (size_t)n);
+    line->len += n;
+    line->buf[line->len] = '\0';
+
+    // The inserted text pushes the tail right: re-send both, then step back over the tail
+    print_shell("%.*s", n + tail, line->buf + line->cursor);
+    emit_back(tail);
+    line->cursor += n;
+}
+
+void shell_line_delete(ShellLine_t *line, int from, int to) {
+    int n;
+
+    if (from < 0) {
+        from = 0;
+    }
+    if (to > line->len) {
+        to = line->len;
+    }
+    if (from >= to) {
+        return;
+    }
+
+    shell_line_move(line, from);
+    n = to - from;
+    if (to == line->len) {
+        print_shell("\033[K");
+    } else if (n == 1) {
+        print_shell("\033[P");
+    } else {
+        print_shell("\033[%dP", n);
+    }
+
+    memmove(line->buf + from, line->buf + to, (size_t)(line->len - to));
+    line->len -= n;
+    line->buf[line->len] = '\0';
+}
+
+void shell_line_replace(ShellLine_t *line, const char *s, int n) {
+    int common = 0;
+
+    if (n > line->size - 1) {
+        n = line->size - 1;
+    }
+    // Keep whatever prefix is already on screen and rewrite from there
+    while (common < n && common < line->len && line->buf[common] == s[common]) {
+        common++;
+    }
+    shell_line_move(line, common);
+
+    if (n > common) {
+        print_shell("%.*s", n - common, s + common);
+    }
+    if (line->len > n) {
+        print_shell("\033[K");
+    }
+
+    memmove(line->buf + common, s + common, (size_t)(n - common));
+    line->len = n;
+    line->cursor = n;
+    line->buf[n] = '\0';
+}
+
+int shell_line_word_left(const ShellLine_t *line) {
+    int i = line->cursor;
+
+    while (i > 0 && line->buf[i - 1] == ' ') i--;
+    while (i > 0 && line->buf[i - 1] != ' ') i--;
+    return i;
+}
+
+int shell_line_word_right(const ShellLine_t *line) {
+    int i = line->cursor;
+
+    while (i < line->len && line->buf[i] == ' ') i++;
+    while (i < line->len && line->buf[i] != ' ') i++;
+    return i;
+}
@@ -0,0 +1,313 @@
+#include "shell_pipe.h"
+#include "shell.h"
+#include "shell_jobs.h"
+#include <ctype.h>
+#include <string.h>
+
+_Static_assert(RING_IS_POW2(SHELL_PIPE_TAIL_SIZE), "SHELL_PIPE_TAIL_SIZE must be a power of two");
+_Static_assert(SHELL_PIPE_LINE_SIZE <= 255, "tail stores line lengths in one byte");
+
+struct ShellFilter_s {
+    const char *name;
+    const char *args;
+    int (*start)(ShellPipe_t *pipe, ShellPipeStage_t *stage, int argc, ShellArg_t *argv);
+    void (*line)(ShellPipeStage_t *stage, const char *text, size_t len);
+    void (*end)(ShellPipeStage_t *stage);
+    const char *help;
+};
+
+static void emit(ShellPipeStage_t *stage, const char *data, size_t len) {
+    stage->next(stage->next_ctx, data, len);
+}
+
+static void emit_line(ShellPipeStage_t *stage, const char *text, size_t len) {
+    emit(stage, text, len);
+    emit(stage, "\r\n", 2);
+}
+
+// grep [-v] <pattern>
+static int contains_nocase(const char *text, size_t len, const char *pattern, size_t pattern_len) {
+    for (size_t start = 0; start + pattern_len <= len; start++) {
+        size_t i = 0;
+
+        while (i < pattern_len &&
+               tolower((unsigned char)text[start + i]) == tolower((unsigned char)pattern[i])) {
+            i++;
+        }
+        if (i == pattern_len) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int grep_start(ShellPipe_t *pipe, ShellPipeStage_t *stage, int argc, ShellArg_t *argv) {
+    (void)pipe;
+    (void)argc;
+    stage->u.grep.invert = argv[1].str != NULL;
+    stage->u.grep.pattern = argv[2].str;
+    stage->u.grep.pattern_len = strlen(argv[2].str);
+    return 0;
+}
+
+static void grep_line(ShellPipeStage_t *stage, const char *text, size_t len) {
+    int match = contains_nocase(text, len, stage->u.grep.pattern, stage->u.grep.pattern_len);
+
+    if (match != stage->u.grep.invert) {
+        emit_line(stage, text, len);
+    }
+}
+
+// head / tail [-n] [lines]
+static int lines_start(ShellPipe_t *pipe, ShellPipeStage_t *stage, int argc, ShellArg_t *argv) {
+    (void)pipe;
+    stage->u.lines.limit = argc > 2 ? argv[2].num : SHELL_PIPE_DEFAULT_LINES;
+    stage->u.lines.lines = 0;
+    stage->u.lines.ring = NULL;
+    return 0;
+}
+
+static void head_line(ShellPipeStage_t *stage, const char *text, size_t len) {
+    // Enough lines: ask the command to stop, like SIGPIPE; output it still produces is dropped
+    if (stage->u.lines.lines < stage->u.lines.limit) {
+        stage->u.lines.lines++;
+        emit_line(stage, text, len);
+    }
+    if (stage->u.lines.lines >= stage->u.lines.limit) {
+        shell_context()->cancel = 1;
+    }
+}
+
+static int tail_start(ShellPipe_t *pipe, ShellPipeStage_t *stage, int argc, ShellArg_t *argv) {
+    for (int i = 0; i < pipe->count; i++) {
+        if (pipe->stages[i].u.lines.ring != NULL && pipe->stages[i].filter == stage->filter) {
+            print_shell("tail: only one tail per pipeline\r\n");
+            return -1;
+        }
+    }
+    lines_start(pipe, stage, argc, argv);
+    ring_init(&pipe->tail, pipe->tail_storage, SHELL_PIPE_TAIL_SIZE);
+    stage->u.lines.ring = &pipe->tail;
+    return 0;
+}
+
+static void tail_line(ShellPipeStage_t *stage, const char *text, size_t len) {
+    RingBuffer_t *ring = stage->u.lines.ring;
+
+    if (stage->u.lines.limit == 0) {
+        return;
+    }
+    // Lines are kept as [len][text]; drop the oldest until this one fits
+    while (stage->u.lines.lines >= stage->u.lines.limit || ring_space(ring) < len + 1) {
+        ring_commit(ring, (uint32_t)ring_getc(ring));
+        stage->u.lines.lines--;
+    }
+    ring_putc(ring, (uint8_t)len);
+    ring_write(ring, (const uint8_t *)text, (uint32_t)len);
+    stage->u.lines.lines++;
+}
+
+static void tail_end(ShellPipeStage_t *stage) {
+    RingBuffer_t *ring = stage->u.lines.ring;
+    int len;
+
+    // The line buffer is free by now
+    while ((len = ring_getc(ring)) >= 0) {
+        ring_read(ring, (uint8_t *)stage->line, (uint32_t)len);
+        emit_line(stage, stage->line, (size_t)len);
+    }
+}
+
+// count
+static void count_line(ShellPipeStage_t *stage, const char *text, size_t len) {
+    (void)text;
+    (void)len;
+    stage->u.lines.lines++;
+}
+
+static void count_end(ShellPipeStage_t *stage) {
+    fmt_printf(stage->next, stage->next_ctx, "%lu\r\n", (unsigned long)stage->u.lines.lines);
+}
+
+// hex2bin
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = (char)tolower((unsigned char)c);
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static void hex2bin_line(ShellPipeStage_t *stage, const char *text, size_t len) {
+    size_t done = 0;
+    size_t i = 0;
+
+    while (i + 2 < len) {
+        size_t digits = 0;
+        uint32_t value = 0;
+
+        if (text[i] != '0' || (text[i + 1] != 'x' && text[i + 1] != 'X') ||
+            (i > 0 && isalnum((unsigned char)text[i - 1]))) {
+            i++;
+            continue;
+        }
+        while (i + 2 + digits < len && hex_digit(text[i + 2 + digits]) >= 0) {
+            value = (value << 4) | (uint32_t)hex_digit(text[i + 2 + digits]);
+            digits++;
+        }
+        if (digits == 0 || digits > 8 ||
+            (i + 2 + digits < len && isalnum((unsigned char)text[i + 2 + digits]))) {
+            i += 2 + digits;
+            continue;
+        }
+
+        emit(stage, text + done, i - done);
+        fmt_printf(stage->next, stage->next_ctx, "0b%'0*lb", (int)digits * 4, (unsigned long)value);
+        i += 2 + digits;
+        done = i;
+    }
+    emit(stage, text + done, len - done);
+    emit(stage, "\r\n", 2);
+}
+
+// Sorted by name
+static const ShellFilter_t shell_filters[] = {
+    { "count",   "",                   lines_start, count_line,   count_end, "Count lines" },
+    { "grep",    "[-v] <pattern:str>", grep_start,  grep_line,    NULL,      "Lines containing pattern (-v: not containing)" },
+    { "head",    "[-n] [lines:int]",   lines_start, head_line,    NULL,      "First lines (default 10)" },
+    { "hex2bin", "",                   NULL,        hex2bin_line, NULL,      "Show 0x numbers in binary" },
+    { "tail",    "[-n] [lines:int]",   tail_start,  tail_line,    tail_end,  "Last lines (default 10)" },
+};
+
+static const ShellFilter_t* find_filter(const char *name) {
+    for (size_t i = 0; i < sizeof(shell_filters) / sizeof(shell_filters[0]); i++) {
+        if (strcmp(name, shell_filters[i].name) == 0) {
+            return &shell_filters[i];
+        }
+    }
+    return NULL;
+}
+
+static void finish_line(ShellPipeStage_t *stage) {
+    size_t len = stage->len;
+
+    if (len > 0 && stage->line[len - 1] == '\r') {
+        len--;
+    }
+    stage->len = 0;
+    stage->filter->line(stage, stage->line, len);
+}
+
+// Sink of one stage: collect a line, then filter it
+static void stage_write(void *ctx, const char *data, size_t len) {
+    ShellPipeStage_t *stage = ctx;
+
+    while (len > 0) {
+        const char *nl = memchr(data, '\n', len);
+        size_t n = nl ? (size_t)(nl - data) : len;
+        size_t room = sizeof(stage->line) - stage->len;
+        size_t copy = n < room ? n : room;
+
+        memcpy(stage->line + stage->len, data, copy);
+        stage->len += copy;
+        if (nl == NULL) {
+            break;
+        }
+        finish_line(stage);
+        data += n + 1;
+        len -= n + 1;
+    }
+}
+
+int shell_pipe_split(char *line, char **segments, int max) {
+    char quote = 0;
+    int count = 1;
+
+    segments[0] = line;
+    for (char *p = line; *p != '\0'; p++) {
+        if (*p == '\\' && quote != '\'' && p[1] != '\0') {
+            p++;
+        } else if (quote != 0) {
+            if (*p == quote) {
+                quote = 0;
+            }
+        } else if (*p == '"' || *p == '\'') {
+            quote = *p;
+        } else if (*p == '|') {
+            if (count == max) {
+                return -1;
+            }
+            *p = '\0';
+            segments[count++] = p + 1;
+        }
+    }
+    return count;
+}
+
+int shell_pipe_open(ShellPipe_t *pipe, int count, char **segments) {
+    pipe->count = 0;
+
+    for (int i = 0; i < count; i++) {
+        ShellPipeStage_t *stage = &pipe->stages[i];
+        char *tokv[SHELL_MAX_ARGS];
+        ShellArg_t argv[SHELL_MAX_ARGS];
+        int tokc = shell_tokenize(segments[i], tokv, NULL, SHELL_MAX_ARGS);
+        int argc;
+
+        if (tokc <= 0) {
+            print_shell(tokc == 0 ? "empty pipeline stage\r\n" : "bad pipeline stage\r\n");
+            return -1;
+        }
+        memset(stage, 0, sizeof(*stage));
+        stage->filter = find_filter(tokv[0]);
+        if (stage->filter == NULL) {
+            print_shell("unknown filter: %s (", tokv[0]);
+            for (size_t f = 0; f < sizeof(shell_filters) / sizeof(shell_filters[0]); f++) {
+                print_shell("%s%s", f ? "|" : "", shell_filters[f].name);
+            }
+            print_shell(")\r\n");
+            return -1;
+        }
+        argc = shell_args_bind(stage->filter->name, stage->filter->args, tokc, tokv, NULL, argv);
+        if (argc < 0) {
+            return -1;
+        }
+        if (stage->filter->start != NULL && stage->filter->start(pipe, stage, argc, argv) != 0) {
+            return -1;
+        }
+        pipe->count++;
+    }
+
+    // Chain the stages: command -> stage 0 -> ... -> current output
+    shell_get_output(&pipe->saved, &pipe->saved_ctx);
+    for (int i = 0; i < count; i++) {
+        pipe->stages[i].next = i + 1 < count ? stage_write : pipe->saved;
+        pipe->stages[i].next_ctx = i + 1 < count ? (void *)&pipe->stages[i + 1] : pipe->saved_ctx;
+    }
+    shell_set_output(stage_write, &pipe->stages[0]);
+    return 0;
+}
+
+void shell_pipe_close(ShellPipe_t *pipe) {
+    // In order, so each stage's leftovers still pass through the stages after it
+    for (int i = 0; i < pipe->count; i++) {
+        ShellPipeStage_t *stage = &pipe->stages[i];
+
+        if (stage->len > 0) {
+            finish_line(stage);
+        }
+        if (stage->filter->end != NULL) {
+            stage->filter->end(stage);
+        }
+    }
+    shell_set_output(pipe->saved, pipe->saved_ctx);
+}
+
+void shell_pipe_list_filters(void) {
+    for (size_t i = 0; i < sizeof(shell_filters) / sizeof(shell_filters[0]); i++) {
+        const ShellFilter_t *f = &shell_filters[i];
+        int used = (int)strlen(f->name) + 2 + (f->args[0] ? 1 + (int)strlen(f->args) : 0);
+
+        print_shell("  | %s%s%s%*s - %s\r\n", f->name, f->args[0] ? " " : "", f->args,
+                    used < 25 ? 25 - used : 0, "", f->help);
+    }
+}
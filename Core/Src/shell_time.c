@@ -0,0 +1,88 @@
+#include "shell_time.h"
+#include "shell.h"
+#include "shell_cmd.h"
+#include "shell_jobs.h"
+#include "uart_driver.h"
+#include "dwt.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+extern volatile uint32_t ulContextSwitchCount;
+
+// Kept out of line so its frame, and not the caller's, is what the margin protects
+static __attribute__((noinline)) uint32_t* paint_stack(uint32_t *base) {
+    uint32_t *top = (uint32_t *)__get_PSP() - SHELL_TIME_PAINT_MARGIN;
+
+    for (volatile uint32_t *p = base; p < top; p++) {
+        *p = SHELL_TIME_FILL;
+    }
+    return top;
+}
+
+void shell_time_start(ShellTime_t *t) {
+    TaskStatus_t status;
+
+    // The stack grows down from the end of the block that starts at pxStackBase
+    vTaskGetInfo(NULL, &status, pdFALSE, eRunning);
+    t->stack_base = (uint32_t *)status.pxStackBase;
+    t->stack_top = paint_stack(t->stack_base);
+
+    DWT_Enable();
+    t->switches = ulContextSwitchCount;
+    t->tx_blocked_cycles = UART_GetStats()->tx_blocked_cycles;
+    t->ticks = xTaskGetTickCount();
+    t->cycles = DWT_GetCycles();
+}
+
+void shell_time_stop(ShellTime_t *t) {
+    uint32_t *p = t->stack_base;
+
+    t->cycles = DWT_GetCycles() - t->cycles;
+    t->ticks = xTaskGetTickCount() - t->ticks;
+    t->tx_blocked_cycles = UART_GetStats()->tx_blocked_cycles - t->tx_blocked_cycles;
+    t->switches = ulContextSwitchCount - t->switches;
+
+    while (p < t->stack_top && *p == SHELL_TIME_FILL) {
+        p++;
+    }
+    t->stack_used = (uint32_t)(t->stack_top - p) * sizeof(uint32_t);
+    t->stack_free = (uint32_t)(p - t->stack_base) * sizeof(uint32_t);
+}
+
+// Microseconds from cycles while CYCCNT cannot have wrapped (about 51 s at 84 MHz), else from ticks
+static uint32_t elapsed_us(const ShellTime_t *t) {
+    uint32_t mhz = SystemCoreClock / 1000000u;
+
+    if (t->ticks * portTICK_PERIOD_MS < UINT32_MAX / SystemCoreClock * 1000u) {
+        return t->cycles / mhz;
+    }
+    return t->ticks * portTICK_PERIOD_MS * 1000u;
+}
+
+static void time_cmd(int argc, ShellArg_t *argv) {
+    char command[CMD_BUFFER_SIZE];
+    ShellTime_t t;
+    uint32_t us;
+
+    // A quoted "cmd | filter" is timed with its filters; an unquoted one filters this report too
+    if (shell_args_rest(argc, argv, 1, command, sizeof(command)) < 0) {
+        print_shell("time: command too long\r\n");
+        return;
+    }
+
+    shell_time_start(&t);
+    process_command(command);
+    shell_time_stop(&t);
+
+    us = elapsed_us(&t);
+    print_shell("\r\n");
+    print_shell("real     %lu.%03lu ms\r\n", (unsigned long)(us / 1000), (unsigned long)(us % 1000));
+    print_shell("cycles   %'lu\r\n", (unsigned long)t.cycles);
+    print_shell("uart     %lu.%03lu ms blocked on TX\r\n",
+                (unsigned long)(t.tx_blocked_cycles / (SystemCoreClock / 1000u)),
+                (unsigned long)(t.tx_blocked_cycles / (SystemCoreClock / 1000000u) % 1000));
+    print_shell("switches %lu\r\n", (unsigned long)t.switches);
+    print_shell("stack    %lu bytes (%lu never used)%s\r\n", (unsigned long)t.stack_used,
+                (unsigned long)t.stack_free, shell_cancelled() ? "  [cancelled]" : "");
+}
+SHELL_COMMAND(time, time_cmd, "<command...>", "Run a command and report cycles, time, UART wait and stack");
@@ -0,0 +1,227 @@
+#include "shell_vt.h"
+#include <string.h>
+
+// Byte classes
+enum {
+    C_CTRL,         // C0 controls except ESC
+    C_ESC,
+    C_DIGIT,        // 0-9
+    C_SEMI,         // ;
+    C_INTER,        // 0x20-0x2F intermediates (and blank)
+    C_MARKER,       // < = > ? private markers
+    C_CSI,          // [
+    C_SS3,          // O
+    C_FINAL,        // rest of 0x40-0x7E
+    C_DEL,
+    C_HIGH,         // 0x80-0xFF
+    C_COUNT
+};
+
+// States
+enum {
+    S_GROUND,
+    S_ESCAPE,
+    S_CSI,
+    S_SS3,
+    S_COUNT
+};
+
+// Actions
+enum {
+    A_NONE,
+    A_PRINT,        // plain character
+    A_CTRL,         // control key
+    A_META,         // ESC + character
+    A_CLEAR,        // start of a CSI/SS3 sequence
+    A_PARAM,        // digit of the current parameter
+    A_NEXT,         // ; starts the next parameter
+    A_MARKER,       // private marker / intermediate
+    A_CSI,          // final byte of CSI
+    A_SS3           // final byte of SS3
+};
+
+#define T(action, next) (uint8_t)(((action) << 4) | (next))
+#define T_ACTION(t)     ((t) >> 4)
+#define T_NEXT(t)       ((t) & 0x0F)
+
+static const uint8_t vt_class[128] = {
+    [0x00 ... 0x1A] = C_CTRL,
+    [0x1B]          = C_ESC,
+    [0x1C ... 0x1F] = C_CTRL,
+    [0x20 ... 0x2F] = C_INTER,
+    [0x30 ... 0x39] = C_DIGIT,
+    [0x3A]          = C_INTER,      // ':' sub-parameters are not used by any key
+    [0x3B]          = C_SEMI,
+    [0x3C ... 0x3F] = C_MARKER,
+    [0x40 ... 0x4E] = C_FINAL,
+    ['O']           = C_SS3,
+    [0x50 ... 0x5A] = C_FINAL,
+    ['[']           = C_CSI,
+    [0x5C ... 0x7E] = C_FINAL,
+    [0x7F]          = C_DEL,
+};
+
+static const uint8_t vt_table[S_COUNT][C_COUNT] = {
+    [S_GROUND] = {
+        [C_CTRL]   = T(A_CTRL,   S_GROUND),
+        [C_ESC]    = T(A_NONE,   S_ESCAPE),
+        [C_DIGIT]  = T(A_PRINT,  S_GROUND),
+        [C_SEMI]   = T(A_PRINT,  S_GROUND),
+        [C_INTER]  = T(A_PRINT,  S_GROUND),
+        [C_MARKER] = T(A_PRINT,  S_GROUND),
+        [C_CSI]    = T(A_PRINT,  S_GROUND),
+        [C_SS3]    = T(A_PRINT,  S_GROUND),
+        [C_FINAL]  = T(A_PRINT,  S_GROUND),
+        [C_DEL]    = T(A_CTRL,   S_GROUND),
+        [C_HIGH]   = T(A_NONE,   S_GROUND),
+    },
+    [S_ESCAPE] = {
+        [C_CTRL]   = T(A_CTRL,   S_GROUND),     // a lone ESC does not swallow Ctrl+C
+        [C_ESC]    = T(A_NONE,   S_ESCAPE),
+        [C_DIGIT]  = T(A_META,   S_GROUND),
+        [C_SEMI]   = T(A_META,   S_GROUND),
+        [C_INTER]  = T(A_META,   S_GROUND),
+        [C_MARKER] = T(A_META,   S_GROUND),
+        [C_CSI]    = T(A_CLEAR,  S_CSI),
+        [C_SS3]    = T(A_CLEAR,  S_SS3),
+        [C_FINAL]  = T(A_META,   S_GROUND),
+        [C_DEL]    = T(A_META,   S_GROUND),
+        [C_HIGH]   = T(A_NONE,   S_GROUND),
+    },
+    [S_CSI] = {
+        [C_CTRL]   = T(A_NONE,   S_CSI),
+        [C_ESC]    = T(A_NONE,   S_ESCAPE),
+        [C_DIGIT]  = T(A_PARAM,  S_CSI),
+        [C_SEMI]   = T(A_NEXT,   S_CSI),
+        [C_INTER]  = T(A_MARKER, S_CSI),
+        [C_MARKER] = T(A_MARKER, S_CSI),
+        [C_CSI]    = T(A_CSI,    S_GROUND),
+        [C_SS3]    = T(A_CSI,    S_GROUND),
+        [C_FINAL]  = T(A_CSI,    S_GROUND),
+        [C_DEL]    = T(A_NONE,   S_CSI),
+        [C_HIGH]   = T(A_NONE,   S_GROUND),
+    },
+    [S_SS3] = {
+        [C_CTRL]   = T(A_NONE,   S_SS3),
+        [C_ESC]    = T(A_NONE,   S_ESCAPE),
+        [C_DIGIT]  = T(A_PARAM,  S_SS3),
+        [C_SEMI]   = T(A_NEXT,   S_SS3),
+        [C_INTER]  = T(A_NONE,   S_GROUND),
+        [C_MARKER] = T(A_NONE,   S_GROUND),
+        [C_CSI]    = T(A_SS3,    S_GROUND),
+        [C_SS3]    = T(A_SS3,    S_GROUND),
+        [C_FINAL]  = T(A_SS3,    S_GROUND),
+        [C_DEL]    = T(A_NONE,   S_SS3),
+        [C_HIGH]   = T(A_NONE,   S_GROUND),
+    },
+};
+
+// ESC [ n ~ keys, by n
+static const uint8_t vt_tilde_keys[] = {
+    [1] = VT_KEY_HOME,
+    [2] = VT_KEY_INSERT,
+    [3] = VT_KEY_DELETE,
+    [4] = VT_KEY_END,
+    [5] = VT_KEY_PAGE_UP,
+    [6] = VT_KEY_PAGE_DOWN,
+    [7] = VT_KEY_HOME,
+    [8] = VT_KEY_END,
+};
+
+void shell_vt_init(VtParser_t *vt) {
+    memset(vt, 0, sizeof(*vt));
+}
+
+static uint16_t param(const VtParser_t *vt, int i, uint16_t def) {
+    return (i < vt->nparams && vt->params[i] != 0) ? vt->params[i] : def;
+}
+
+// Final letters shared by CSI and SS3 (ESC [ A and ESC O A are both Up)
+static VtKey_t letter_key(uint8_t c) {
+    switch (c) {
+        case 'A': return VT_KEY_UP;
+        case 'B': return VT_KEY_DOWN;
+        case 'C': return VT_KEY_RIGHT;
+        case 'D': return VT_KEY_LEFT;
+        case 'H': return VT_KEY_HOME;
+        case 'F': return VT_KEY_END;
+        default:  return VT_KEY_NONE;
+    }
+}
+
+static VtKey_t csi_key(const VtParser_t *vt, uint8_t c, VtEvent_t *ev) {
+    if (vt->marker != 0) {
+        return VT_KEY_NONE;     // private replies (DA, DECRPM...) are not keys
+    }
+    if (c == '~') {
+        uint16_t n = param(vt, 0, 0);
+        return n < sizeof(vt_tilde_keys) ? (VtKey_t)vt_tilde_keys[n] : VT_KEY_NONE;
+    }
+    if (c == 'R' && vt->nparams == 2) {
+        ev->row = param(vt, 0, 1);
+        ev->col = param(vt, 1, 1);
+        return VT_KEY_CURSOR_REPORT;
+    }
+    return letter_key(c);
+}
+
+int shell_vt_feed(VtParser_t *vt, uint8_t c, VtEvent_t *ev) {
+    uint8_t t = vt_table[vt->state][c < 0x80 ? vt_class[c] : C_HIGH];
+
+    vt->state = T_NEXT(t);
+    ev->key = VT_KEY_NONE;
+    ev->mods = 0;
+    ev->ch = (char)c;
+
+    switch (T_ACTION(t)) {
+        case A_PRINT:
+            ev->key = VT_KEY_CHAR;
+            break;
+        case A_CTRL:
+            ev->key = VT_KEY_CTRL;
+            break;
+        case A_META:
+            ev->key = VT_KEY_META;
+            ev->mods = VT_MOD_ALT;
+            break;
+        case A_CLEAR:
+            vt->nparams = 0;
+            vt->marker = 0;
+            memset(vt->params, 0, sizeof(vt->params));
+            break;
+        case A_PARAM:
+            if (vt->nparams == 0) {
+                vt->nparams = 1;
+            }
+            if (vt->nparams <= VT_MAX_PARAMS) {
+                uint16_t *p = &vt->params[vt->nparams - 1];
+                unsigned d = (unsigned)(c - '0');
+
+                // Saturate at 65535: 6553 * 10 + 6..9 would wrap
+                *p = (*p > (65535 - d) / 10) ? 65535 : (uint16_t)(*p * 10 + d);
+            }
+            break;
+        case A_NEXT:
+            // An empty first parameter still counts: ESC [ ; 5 D
+            if (vt->nparams <= VT_MAX_PARAMS) {
+                vt->nparams = (uint8_t)((vt->nparams == 0 ? 1 : vt->nparams) + 1);
+            }
+            break;
+        case A_MARKER:
+            vt->marker = c;
+            break;
+        case A_CSI:
+            ev->key = csi_key(vt, c, ev);
+            break;
+        case A_SS3:
+            ev->key = letter_key(c);
+            break;
+        default:
+            break;
+    }
+
+    if (ev->key >= VT_KEY_UP && ev->key < VT_KEY_CURSOR_REPORT && vt->nparams >= 2) {
+        ev->mods = (uint8_t)(param(vt, 1, 1) - 1);
+    }
+    return ev->key != VT_KEY_NONE;
+}
@@ -0,0 +1,235 @@
+#include "shell_watch.h"
+#include "shell.h"
+#include "shell_cmd.h"
+#include "shell_jobs.h"
+#include "FreeRTOS.h"
+#include "timers.h"
+#include <string.h>
+
+// Re-sending this many unchanged cells is cheaper than a cursor address (ESC [ r ; c H)
+#define WATCH_SHORT_SKIP 4
+#define WATCH_COL_MAX    255     // watch.col saturates here on over-long lines
+
+static struct {
+    volatile uint8_t active;
+    volatile uint8_t due;
+    TimerHandle_t timer;
+    char command[CMD_BUFFER_SIZE];
+    char scratch[CMD_BUFFER_SIZE];      // process_command() tokenizes in place
+
+    // What the terminal shows, row by row
+    char screen[WATCH_ROWS][WATCH_COLS];
+    uint8_t shown_len[WATCH_ROWS];
+    uint8_t shown_rows;
+
+    // Frame being drawn
+    uint8_t row;
+    uint8_t col;
+    uint8_t cols;
+    uint8_t esc;
+    uint8_t cur_row;                    // terminal cursor, valid if cur_valid
+    uint8_t cur_col;
+    uint8_t cur_valid;
+    fmt_write_fn out;
+    void *out_ctx;
+} watch;
+
+static void emit(const char *data, size_t len) {
+    watch.out(watch.out_ctx, data, len);
+}
+
+static void goto_cell(uint8_t row, uint8_t col) {
+    if (watch.cur_valid && watch.cur_row == row) {
+        if (watch.cur_col == col) {
+            return;
+        }
+        if (col > watch.cur_col && col - watch.cur_col <= WATCH_SHORT_SKIP) {
+            emit(&watch.screen[row][watch.cur_col], col - watch.cur_col);
+            watch.cur_col = col;
+            return;
+        }
+    }
+    fmt_printf(watch.out, watch.out_ctx, "\033[%u;%uH", row + WATCH_FIRST_ROW, col + 1u);
+    watch.cur_row = row;
+    watch.cur_col = col;
+    watch.cur_valid = 1;
+}
+
+static void put_char(char c) {
+    uint8_t row = watch.row;
+    uint8_t col = watch.col;
+
+    if (col < WATCH_COL_MAX) {
+        watch.col++;
+    }
+    if (row >= WATCH_ROWS || col >= watch.cols) {
+        return;
+    }
+    if (col < watch.shown_len[row] && watch.screen[row][col] == c) {
+        return;
+    }
+    goto_cell(row, col);
+    emit(&c, 1);
+    watch.screen[row][col] = c;
+    watch.cur_col++;
+    if (watch.cur_col >= watch.cols) {
+        watch.cur_valid = 0;            // terminals differ at the right margin
+    }
+}
+
+static void end_line(void) {
+    uint8_t row = watch.row;
+    uint8_t len = watch.col < watch.cols ? watch.col : watch.cols;
+
+    if (row < WATCH_ROWS) {
+        if (watch.shown_len[row] > len) {
+            goto_cell(row, len);
+            emit("\033[K", 3);
+        }
+        watch.shown_len[row] = len;
+    }
+    if (watch.row < 255) {
+        watch.row++;
+    }
+    watch.col = 0;
+}
+
+static void end_frame(void) {
+    uint8_t rows;
+
+    if (watch.col > 0) {
+        end_line();
+    }
+    rows = watch.row < WATCH_ROWS ? watch.row : WATCH_ROWS;
+    for (uint8_t row = rows; row < watch.shown_rows; row++) {
+        if (watch.shown_len[row] > 0) {
+            goto_cell(row, 0);
+            emit("\033[K", 3);
+            watch.shown_len[row] = 0;
+        }
+    }
+    watch.shown_rows = rows;
+}
+
+// print_shell sink while the command runs: diff against the screen model
+static void watch_sink(void *ctx, const char *data, size_t len) {
+    (void)ctx;
+
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+
+        // Drop escape sequences from the command (ESC x, ESC [ ... final)
+        if (watch.esc == 1) {
+            watch.esc = (c == '[') ? 2 : 0;
+            continue;
+        }
+        if (watch.esc == 2) {
+            if (c >= 0x40 && c <= 0x7E) {
+                watch.esc = 0;
+            }
+            continue;
+        }
+
+        switch (c) {
+            case '\033':
+                watch.esc = 1;
+                break;
+            case '\n':
+                end_line();
+                break;
+            case '\t':
+                // 255 is not a tab stop, so stop where col saturates
+                do {
+                    put_char(' ');
+                } while (watch.col % 8 != 0 && watch.col < WATCH_COL_MAX);
+                break;
+            default:
+                if (c >= 0x20 && c < 0x7F) {
+                    put_char(c);
+                }
+                break;
+        }
+    }
+}
+
+static void watch_timer_cb(TimerHandle_t timer) {
+    (void)timer;
+    watch.due = 1;
+    shell_wake();
+}
+
+int shell_watch_active(void) {
+    return watch.active;
+}
+
+void shell_watch_poll(void) {
+    uint16_t width = shell_term_width();
+
+    if (!watch.active || !watch.due) {
+        return;
+    }
+    watch.due = 0;
+
+    watch.row = 0;
+    watch.col = 0;
+    watch.esc = 0;
+    watch.cols = width < WATCH_COLS ? (uint8_t)width : WATCH_COLS;
+
+    shell_get_output(&watch.out, &watch.out_ctx);
+    shell_set_output(watch_sink, NULL);
+    memcpy(watch.scratch, watch.command, sizeof(watch.scratch));
+    shell_context()->cancel = 0;        // each frame is a fresh run; Ctrl+C stops the watch itself
+    process_command(watch.scratch);
+    end_frame();
+    shell_set_output(watch.out, watch.out_ctx);
+}
+
+void shell_watch_stop(void) {
+    if (!watch.active) {
+        return;
+    }
+    xTimerStop(watch.timer, 0);
+    watch.active = 0;
+    watch.due = 0;
+    // Leave the cursor below the last frame
+    print_shell("\033[%u;1H\r\n", watch.shown_rows + WATCH_FIRST_ROW);
+}
+
+static void watch_cmd(int argc, ShellArg_t *argv) {
+    uint32_t ms = argv[2].num;
+
+    if (shell_in_background()) {
+        print_shell("watch: foreground only\r\n");
+        return;
+    }
+    if (ms < WATCH_MIN_MS) {
+        print_shell("watch: interval must be at least %u ms\r\n", WATCH_MIN_MS);
+        return;
+    }
+
+    // The command words as typed; a quoted "cmd | filter" stays one pipeline
+    if (shell_args_rest(argc, argv, 3, watch.command, sizeof(watch.command)) < 0) {
+        print_shell("watch: command too long\r\n");
+        return;
+    }
+
+    if (watch.timer == NULL) {
+        watch.timer = xTimerCreate("watch", pdMS_TO_TICKS(ms), pdTRUE, NULL, watch_timer_cb);
+        if (watch.timer == NULL) {
+            print_shell("watch: no memory for the timer\r\n");
+            return;
+        }
+    } else {
+        xTimerChangePeriod(watch.timer, pdMS_TO_TICKS(ms), 0);
+    }
+
+    memset(watch.shown_len, 0, sizeof(watch.shown_len));
+    watch.shown_rows = 0;
+    watch.cur_valid = 0;
+    print_shell("\033[2J\033[HEvery %lums: %s    (Ctrl+C to stop)\r\n", (unsigned long)ms, watch.command);
+
+    watch.active = 1;
+    watch.due = 1;                      // first frame as soon as the shell task is free
+    xTimerStart(watch.timer, 0);
+}
+SHELL_COMMAND(watch, watch_cmd, "[-n] <ms:int> <command...>", "Re-run a command every ms, redrawing only changes");
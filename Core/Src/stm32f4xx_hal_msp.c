@@ -18,6 +18,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
+#include "uart_driver.h"
 
 
 /**
@@ -33,6 +34,7 @@ void HAL_MspInit(void)
   /* System interrupt init*/
 }
 
+#ifndef SHELL_SEMIHOSTING
 void HAL_UART_MspInit(UART_HandleTypeDef *huart) {
     GPIO_InitTypeDef GPIO_InitStruct = {0};
     if (huart->Instance == USART2) {
@@ -46,5 +48,49 @@ void HAL_UART_MspInit(UART_HandleTypeDef *huart) {
         GPIO_InitStruct.Alternate = GPIO_AF7_USART2;
 
         HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+        __HAL_RCC_DMA1_CLK_ENABLE();
+
+#if UART_TX_MODE == UART_TX_MODE_DMA
+        /* USART2_TX: DMA1 Stream6 Channel4, one transfer per queued span */
+        hdma_usart2_tx.Instance = DMA1_Stream6;
+        hdma_usart2_tx.Init.Channel = DMA_CHANNEL_4;
+        hdma_usart2_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+        hdma_usart2_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_usart2_tx.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_usart2_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_usart2_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+        hdma_usart2_tx.Init.Mode = DMA_NORMAL;
+        hdma_usart2_tx.Init.Priority = DMA_PRIORITY_LOW;
+        hdma_usart2_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+
+        if (HAL_DMA_Init(&hdma_usart2_tx) != HAL_OK) {
+            Error_Handler();
+        }
+
+        __HAL_LINKDMA(huart, hdmatx, hdma_usart2_tx);
+#endif
+
+#if UART_RX_MODE == UART_RX_MODE_DMA
+        /* USART2_RX: DMA1 Stream5 Channel4, circular */
+
+        hdma_usart2_rx.Instance = DMA1_Stream5;
+        hdma_usart2_rx.Init.Channel = DMA_CHANNEL_4;
+        hdma_usart2_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+        hdma_usart2_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_usart2_rx.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_usart2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_usart2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+        hdma_usart2_rx.Init.Mode = DMA_CIRCULAR;
+        hdma_usart2_rx.Init.Priority = DMA_PRIORITY_HIGH;
+        hdma_usart2_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+
+        if (HAL_DMA_Init(&hdma_usart2_rx) != HAL_OK) {
+            Error_Handler();
+        }
+
+        __HAL_LINKDMA(huart, hdmarx, hdma_usart2_rx);
+#endif
     }
-}
\ No newline at end of file
+}
+#endif /* SHELL_SEMIHOSTING */
@@ -17,6 +17,7 @@
 
 #include "stm32f4xx_hal.h"
 #include "uart_driver.h"
+#include "dwt.h"
 /******************************************************************************/
 /*           Cortex-M4 Processor Interruption and Exception Handlers          */
 /******************************************************************************/
@@ -110,6 +111,45 @@ void EXTI15_10_IRQHandler(void) {
     HAL_GPIO_EXTI_IRQHandler(B1_Pin);
 }
 
+// USART2 and its DMA streams are not used when the shell runs over semihosting
+#ifndef SHELL_SEMIHOSTING
 void USART2_IRQHandler(void) {
+    uint32_t start = DWT_GetCycles();
+    uint32_t cycles;
+
+#if UART_RX_MODE == UART_RX_MODE_LL
+    UART_LL_IRQHandler();
+#else
     HAL_UART_IRQHandler(UART_GetHandle());
-}
\ No newline at end of file
+#endif
+
+    cycles = DWT_GetCycles() - start;
+    uart_rx_profile.isr_cycles += cycles;
+    if (cycles > uart_rx_profile.isr_max_cycles) {
+        uart_rx_profile.isr_max_cycles = cycles;
+    }
+    uart_rx_profile.isr_count++;
+}
+
+#if UART_TX_MODE == UART_TX_MODE_DMA
+void DMA1_Stream6_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&hdma_usart2_tx);
+}
+#endif
+
+#if UART_RX_MODE == UART_RX_MODE_DMA
+void DMA1_Stream5_IRQHandler(void) {
+    uint32_t start = DWT_GetCycles();
+    uint32_t cycles;
+
+    HAL_DMA_IRQHandler(&hdma_usart2_rx);
+
+    cycles = DWT_GetCycles() - start;
+    uart_rx_profile.isr_cycles += cycles;
+    if (cycles > uart_rx_profile.isr_max_cycles) {
+        uart_rx_profile.isr_max_cycles = cycles;
+    }
+    uart_rx_profile.isr_count++;
+}
+#endif
+#endif /* SHELL_SEMIHOSTING */
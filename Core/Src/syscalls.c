@@ -22,6 +22,7 @@
 
 /* Includes */
 #include <sys/stat.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <stdio.h>
@@ -39,6 +40,29 @@ extern int __io_getchar(void) __attribute__((weak));
 char *__env[1] = { 0 };
 char **environ = __env;
 
+#ifdef SHELL_SEMIHOSTING
+/* ARM semihosting: BKPT 0xAB hands r0 (operation) and r1 (argument block)
+ * to the debugger or QEMU -semihosting, which answers in r0. Without one
+ * attached the breakpoint escalates to a HardFault.
+ */
+#define SYS_OPEN    0x01
+#define SYS_WRITE   0x05
+#define SYS_READC   0x07
+
+#define SYS_OPEN_W  4       /* fopen() mode "w": on ":tt" that is the console output */
+
+static int semihost_call(int op, void *arg)
+{
+  register int r0 __asm__("r0") = op;
+  register void *r1 __asm__("r1") = arg;
+
+  __asm__ volatile ("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+  return r0;
+}
+
+static int semihost_console = -1;
+#endif
+
 
 /* Functions */
 void initialise_monitor_handles()
@@ -64,6 +88,44 @@ void _exit (int status)
   while (1) {}    /* Make sure we hang here */
 }
 
+#ifdef SHELL_SEMIHOSTING
+/* SYS_READC returns one character per trap and stops the core until the
+ * host has one, so only one is read per call.
+ */
+__attribute__((weak)) int _read(int file, char *ptr, int len)
+{
+  (void)file;
+
+  if (len <= 0)
+  {
+    return 0;
+  }
+  *ptr = (char)semihost_call(SYS_READC, NULL);
+  return 1;
+}
+
+/* One SYS_WRITE trap per call, whatever its length: callers that want few
+ * traps hand over whole lines (see uart_semihost.c).
+ */
+__attribute__((weak)) int _write(int file, char *ptr, int len)
+{
+  (void)file;
+  uint32_t args[3];
+
+  if (semihost_console < 0)
+  {
+    args[0] = (uint32_t)":tt";
+    args[1] = SYS_OPEN_W;
+    args[2] = 3;
+    semihost_console = semihost_call(SYS_OPEN, args);
+  }
+
+  args[0] = (uint32_t)semihost_console;
+  args[1] = (uint32_t)ptr;
+  args[2] = (uint32_t)len;
+  return len - semihost_call(SYS_WRITE, args);    /* SYS_WRITE answers with the bytes not written */
+}
+#else
 __attribute__((weak)) int _read(int file, char *ptr, int len)
 {
   (void)file;
@@ -88,6 +150,7 @@ __attribute__((weak)) int _write(int file, char *ptr, int len)
   }
   return len;
 }
+#endif
 
 int _close(int file)
 {
@@ -1,5 +1,12 @@
 #include "uart_driver.h"
+#include "ring_buffer.h"
+#include "fmt.h"
 #include "main.h"
+#include "dwt.h"
+#include "rpc.h"
+#if UART_RX_MODE == UART_RX_MODE_LL
+#include "stm32f4xx_ll_usart.h"
+#endif
 #include <stdarg.h>
 #include <string.h>
 #include <stdio.h>
@@ -8,16 +15,126 @@
 #include "projdefs.h"
 #include "queue.h"
 #include "semphr.h"
+#include "task.h"
+#include "timers.h"
 
 
-uint8_t chrx;
 UART_HandleTypeDef huart2;
-extern SemaphoreHandle_t xBinarySemaphore;
+DMA_HandleTypeDef hdma_usart2_rx;
+DMA_HandleTypeDef hdma_usart2_tx;
+UART_RxProfile_t uart_rx_profile;
+static UART_Stats_t uart_stats;
+extern TaskHandle_t xUARTRxTaskHandle;
+
+/* RX landing buffer, written by the DMA stream (or per byte by the USART2
+ * interrupt in IT/LL mode) and drained by UART_Read() from task context.
+ * rx_head is only written from the ISR, rx_tail only from the reader task.
+ */
+_Static_assert(RING_IS_POW2(UART_RX_BUFFER_SIZE), "UART_RX_BUFFER_SIZE must be a power of two");
+
+static uint8_t rx_dma_buffer[UART_RX_BUFFER_SIZE];
+static volatile uint16_t rx_head;
+static uint16_t rx_tail;
+static volatile uint8_t rx_restart;
+
+/* TX queue, filled by UART_Write() and drained by DMA1 Stream6. Each DMA
+ * transfer covers the contiguous readable span of tx_ring; HAL_UART_TxCpltCallback
+ * commits it and starts the next. Producers may be several tasks or an ISR,
+ * so the producer side is serialised with a critical section.
+ *
+ * In UART_TX_MODE_IT the TXE interrupt drains it a byte at a time instead,
+ * and tx_span is 1 while that interrupt is armed.
+ */
+_Static_assert(RING_IS_POW2(UART_TX_BUFFER_SIZE), "UART_TX_BUFFER_SIZE must be a power of two");
+
+static uint8_t tx_storage[UART_TX_BUFFER_SIZE];
+static RingBuffer_t tx_ring = { tx_storage, UART_TX_BUFFER_SIZE - 1, 0, 0 };
+static volatile uint16_t tx_span;
+static UART_TxPolicy_t tx_policy = UART_TX_BLOCK;
+static uint32_t tx_timeout_ms = 100;
+static SemaphoreHandle_t xTxSpaceSemaphore = NULL;
+
+#if UART_TX_MODE == UART_TX_MODE_IT
+#define TX_IT_WAKE_BYTES 64     // wake writers waiting for queue space every this many bytes
+#endif
+
+#define UART_QUIESCE_TIMEOUT_MS 500     // bound on draining output before a baud or flow change
+
+// Flow control state
+static UART_FlowControl_t flow_mode = UART_FLOW_DEFAULT;
+static volatile uint8_t rx_throttled;   // we asked the host to stop
+static volatile uint8_t tx_paused;      // the host sent XOFF
+static volatile uint8_t tx_control;     // XON/XOFF waiting to go out ahead of the queue
+
+// Throughput history: byte counters sampled once a second by the stats timer
+static uint32_t rx_history[UART_STATS_WINDOW + 1];
+static uint32_t tx_history[UART_STATS_WINDOW + 1];
+static uint8_t history_pos;
+static uint8_t history_len;
+
+// uart_stats counters at the last UART_ResetRxProfile()
+static uint32_t profile_rx_base;
+static uint32_t profile_drop_base;
 
 UART_HandleTypeDef* UART_GetHandle(void) {
     return &huart2;
 }
 
+const UART_RxProfile_t* UART_GetRxProfile(void) {
+    uart_rx_profile.rx_bytes = uart_stats.rx_bytes - profile_rx_base;
+    uart_rx_profile.rx_overflow = uart_stats.rx_dropped - profile_drop_base;
+    return &uart_rx_profile;
+}
+
+void UART_ResetRxProfile(void) {
+    memset(&uart_rx_profile, 0, sizeof(uart_rx_profile));
+    profile_rx_base = uart_stats.rx_bytes;
+    profile_drop_base = uart_stats.rx_dropped;
+}
+
+const UART_Stats_t* UART_GetStats(void) {
+    return &uart_stats;
+}
+
+static void stats_timer_cb(TimerHandle_t timer) {
+    /* Keep the last UART_STATS_WINDOW + 1 samples of the free-running byte
+     * counters; differences between them give the rolling rates without
+     * touching the interrupt path.
+     */
+    uint8_t newest = history_pos;
+    uint8_t oldest;
+    uint8_t prev;
+    uint8_t span;
+
+    (void)timer;
+
+    rx_history[newest] = uart_stats.rx_bytes;
+    tx_history[newest] = uart_stats.tx_bytes;
+    history_pos = (history_pos + 1) % (UART_STATS_WINDOW + 1);
+    if (history_len < UART_STATS_WINDOW + 1) {
+        history_len++;
+    }
+    if (history_len < 2) {
+        return;
+    }
+
+    prev = (newest + UART_STATS_WINDOW) % (UART_STATS_WINDOW + 1);
+    span = history_len - 1;
+    oldest = (newest + UART_STATS_WINDOW + 1 - span) % (UART_STATS_WINDOW + 1);
+
+    uart_stats.rx_rate_1s = rx_history[newest] - rx_history[prev];
+    uart_stats.tx_rate_1s = tx_history[newest] - tx_history[prev];
+    uart_stats.rx_rate_10s = (rx_history[newest] - rx_history[oldest]) / span;
+    uart_stats.tx_rate_10s = (tx_history[newest] - tx_history[oldest]) / span;
+}
+
+// Track the landing buffer fill level; called from the RX interrupt paths
+static inline void rx_note_level(uint16_t unread) {
+    if (unread > uart_stats.rx_high_water) {
+        uart_stats.rx_high_water = unread;
+    }
+}
+
 void UART_Init(void) {
     huart2.Instance = USART2;
     huart2.Init.BaudRate = 115200;
@@ -25,38 +142,601 @@ void UART_Init(void) {
     huart2.Init.StopBits = UART_STOPBITS_1;
     huart2.Init.Parity = UART_PARITY_NONE;
     huart2.Init.Mode = UART_MODE_TX_RX;
+    huart2.Init.OverSampling = UART_OVERSAMPLING_16;
 
     if (HAL_UART_Init(&huart2) != HAL_OK) {
         Error_Handler();
     }
 
+    xTxSpaceSemaphore = xSemaphoreCreateBinary();
+    xTimerStart(xTimerCreate("uart_stats", pdMS_TO_TICKS(1000), pdTRUE, NULL, stats_timer_cb), 0);
+
+#if UART_TX_MODE == UART_TX_MODE_DMA
+    HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+#endif
+#if UART_RX_MODE == UART_RX_MODE_DMA
+    HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+#endif
     HAL_NVIC_SetPriority(USART2_IRQn, 5, 0);
     HAL_NVIC_EnableIRQ(USART2_IRQn);
 }
 
+void UART_StartReceive(void) {
+    rx_head = 0;
+    rx_tail = 0;
+
+#if UART_RX_MODE == UART_RX_MODE_DMA
+    /* Circular DMA with IDLE detection: the HAL raises HAL_UARTEx_RxEventCallback
+     * on half transfer, transfer complete and on every idle line, so a burst costs
+     * at most a handful of interrupts regardless of its length.
+     */
+    HAL_UARTEx_ReceiveToIdle_DMA(&huart2, rx_dma_buffer, UART_RX_BUFFER_SIZE);
+#elif UART_RX_MODE == UART_RX_MODE_LL
+    // The HAL never sees the reception: UART_LL_IRQHandler() owns RXNE
+    LL_USART_EnableIT_RXNE(huart2.Instance);
+#else
+    HAL_UART_Receive_IT(&huart2, &rx_dma_buffer[0], 1);
+#endif
+}
+
+static void tx_kick(void);
+
+// Remove XON/XOFF from received data and apply them to the transmitter
+static size_t flow_filter(uint8_t *data, size_t len) {
+    size_t out = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == UART_XOFF) {
+            tx_paused = 1;
+        } else if (data[i] == UART_XON) {
+            taskENTER_CRITICAL();
+            tx_paused = 0;
+            tx_kick();
+            taskEXIT_CRITICAL();
+        } else {
+            data[out++] = data[i];
+        }
+    }
+    return out;
+}
+
+size_t UART_RxPending(void) {
+    return (uint16_t)(rx_head - rx_tail + UART_RX_BUFFER_SIZE) % UART_RX_BUFFER_SIZE;
+}
+
+size_t UART_Read(uint8_t *dst, size_t len) {
+    size_t n = 0;
+    uint16_t head = rx_head;
+
+    // At most two contiguous copies: up to the end of the landing buffer, then from its start
+    while (rx_tail != head && n < len) {
+        size_t chunk = (head > rx_tail) ? (size_t)(head - rx_tail) : (size_t)(UART_RX_BUFFER_SIZE - rx_tail);
+        if (chunk > len - n) {
+            chunk = len - n;
+        }
+        memcpy(dst + n, &rx_dma_buffer[rx_tail], chunk);
+        rx_tail = (rx_tail + chunk) % UART_RX_BUFFER_SIZE;
+        // RPC frames may carry 0x11/0x13 as data: they are passed through untouched
+        if (flow_mode == UART_FLOW_XONXOFF && !rpc_active()) {
+            chunk = flow_filter(dst + n, chunk);
+        } else if (tx_paused) {
+            // An XOFF from text mode would otherwise hold back every RPC response
+            taskENTER_CRITICAL();
+            tx_paused = 0;
+            tx_kick();
+            taskEXIT_CRITICAL();
+        }
+        n += chunk;
+    }
+
+    // Reception was aborted by an error: restart once everything pending is consumed
+    if (rx_restart && rx_tail == rx_head) {
+        rx_restart = 0;
+        UART_StartReceive();
+    }
+    return n;
+}
+
+// Start a DMA transfer for the next contiguous span (or arm TXE); caller holds the critical section
+static void tx_kick(void) {
+    const uint8_t *span;
+    uint32_t n;
+
+    if (tx_span != 0) {
+        return;
+    }
+
+    // A pending XON/XOFF jumps the queue: the transmitter is idle, so TXE is set
+    if (tx_control != 0) {
+        huart2.Instance->DR = tx_control;
+        tx_control = 0;
+    }
+
+    if (tx_paused || (n = ring_peek_span(&tx_ring, &span)) == 0) {
+        return;
+    }
+
+#if UART_TX_MODE == UART_TX_MODE_IT
+    // UART_LL_IRQHandler() feeds DR from the queue until it runs dry
+    (void)span;
+    tx_span = 1;
+    LL_USART_EnableIT_TXE(huart2.Instance);
+#else
+    // NDTR is 16 bits wide; with XON/XOFF keep spans short so control bytes are not held back
+    if (flow_mode == UART_FLOW_XONXOFF && n > UART_XONXOFF_MAX_SPAN) {
+        n = UART_XONXOFF_MAX_SPAN;
+    } else if (n > 0xFFFF) {
+        n = 0xFFFF;
+    }
+    tx_span = n;
+    if (HAL_UART_Transmit_DMA(&huart2, (uint8_t *)span, tx_span) != HAL_OK) {
+        tx_span = 0;
+    }
+#endif
+}
+
+// Copy up to len bytes into the queue; returns how many were taken
+static size_t tx_enqueue(const uint8_t *data, size_t len, int whole_only) {
+    size_t n = 0;
+    UBaseType_t isr_mask = 0;
+    int in_isr = __get_IPSR() != 0;
+
+    if (in_isr) {
+        isr_mask = taskENTER_CRITICAL_FROM_ISR();
+    } else {
+        taskENTER_CRITICAL();
+    }
+
+    if (!whole_only || ring_space(&tx_ring) >= len) {
+        n = ring_write(&tx_ring, data, len);
+    }
+    if (ring_count(&tx_ring) > uart_stats.tx_high_water) {
+        uart_stats.tx_high_water = (uint16_t)ring_count(&tx_ring);
+    }
+    tx_kick();
+
+    if (in_isr) {
+        taskEXIT_CRITICAL_FROM_ISR(isr_mask);
+    } else {
+        taskEXIT_CRITICAL();
+    }
+    return n;
+}
+
+size_t UART_Write(const uint8_t *data, size_t len) {
+    size_t sent = 0;
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(tx_timeout_ms);
+
+    // Never wait from interrupt context (e.g. the button EXTI callback)
+    UART_TxPolicy_t policy = (__get_IPSR() != 0) ? UART_TX_TRUNCATE : tx_policy;
+
+    switch (policy) {
+        case UART_TX_DROP:
+            sent = tx_enqueue(data, len, 1);
+            break;
+        case UART_TX_TRUNCATE:
+            sent = tx_enqueue(data, len, 0);
+            break;
+        case UART_TX_BLOCK:
+        default:
+            sent = tx_enqueue(data, len, 0);
+            if (sent < len) {
+                uint32_t blocked = DWT_GetCycles();
+
+                while (sent < len) {
+                    TickType_t elapsed = xTaskGetTickCount() - start;
+                    if (elapsed >= timeout ||
+                        xSemaphoreTake(xTxSpaceSemaphore, timeout - elapsed) != pdTRUE) {
+                        break;
+                    }
+                    sent += tx_enqueue(data + sent, len - sent, 0);
+                }
+                blocked = DWT_GetCycles() - blocked;
+                taskENTER_CRITICAL();
+                uart_stats.tx_blocked_cycles += blocked;
+                taskEXIT_CRITICAL();
+            }
+            break;
+    }
+
+    if (sent < len) {
+        taskENTER_CRITICAL();
+        uart_stats.tx_dropped += len - sent;
+        taskEXIT_CRITICAL();
+    }
+    return sent;
+}
+
+int UART_Flush(uint32_t timeout_ms) {
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+
+    while (ring_count(&tx_ring) != 0 || tx_span != 0) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            return -1;
+        }
+        xSemaphoreTake(xTxSpaceSemaphore, timeout - elapsed);
+    }
+    return 0;
+}
+
+void UART_SetTxPolicy(UART_TxPolicy_t policy, uint32_t timeout_ms) {
+    tx_policy = policy;
+    tx_timeout_ms = timeout_ms;
+}
+
+uint32_t UART_GetTxDropped(void) {
+    return uart_stats.tx_dropped;
+}
+
+int UART_CalcBaud(uint32_t baud, UART_BaudConfig_t *cfg) {
+    /* USARTDIV = PCLK1 / (8 * (2 - OVER8) * baud). In units of 1/16 (OVER16)
+     * or 1/8 (OVER8) that is simply PCLK1 / baud, so one rounded division
+     * gives the BRR content. OVER16 is preferred for its noise margin and
+     * OVER8 doubles the reachable rate (PCLK1 / 8, 5.25 Mbaud at 42 MHz).
+     */
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+    uint32_t div;
+
+    if (baud == 0) {
+        return -1;
+    }
+
+    div = (pclk + baud / 2) / baud;
+    if (div >= 16 && div <= 0xFFFF) {
+        cfg->over8 = 0;
+        cfg->brr = (uint16_t)div;
+    } else if (div >= 8 && div < 16) {
+        cfg->over8 = 1;
+        cfg->brr = (uint16_t)(((div >> 3) << 4) | (div & 0x7));
+    } else {
+        return -1;
+    }
+
+    cfg->baud = baud;
+    cfg->actual = pclk / div;
+    cfg->error_ppm = (int32_t)(((int64_t)cfg->actual - baud) * 1000000 / baud);
+    return 0;
+}
+
+/* Wait until nothing is on the wire, then disable the USART for
+ * reconfiguration. Output held back by CTS or an XOFF may never drain, so
+ * both waits share UART_QUIESCE_TIMEOUT_MS; on timeout the USART is left
+ * running and -1 is returned.
+ */
+static int uart_quiesce(void) {
+    TickType_t start = xTaskGetTickCount();
+
+    if (UART_Flush(UART_QUIESCE_TIMEOUT_MS) != 0) {
+        return -1;
+    }
+    while (!__HAL_UART_GET_FLAG(&huart2, UART_FLAG_TC)) {
+        if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(UART_QUIESCE_TIMEOUT_MS)) {
+            return -1;
+        }
+    }
+    __HAL_UART_DISABLE(&huart2);
+    return 0;
+}
+
+int UART_SetBaud(uint32_t baud, UART_BaudConfig_t *cfg) {
+    UART_BaudConfig_t local;
+
+    if (cfg == NULL) {
+        cfg = &local;
+    }
+    if (UART_CalcBaud(baud, cfg) != 0) {
+        return -1;
+    }
+
+    // BRR must not change mid-frame
+    if (uart_quiesce() != 0) {
+        return -1;
+    }
+    MODIFY_REG(huart2.Instance->CR1, USART_CR1_OVER8, cfg->over8 ? USART_CR1_OVER8 : 0);
+    huart2.Instance->BRR = cfg->brr;
+    __HAL_UART_ENABLE(&huart2);
+
+    huart2.Init.BaudRate = baud;
+    huart2.Init.OverSampling = cfg->over8 ? UART_OVERSAMPLING_8 : UART_OVERSAMPLING_16;
+    return 0;
+}
+
+uint32_t UART_GetBaud(void) {
+    return huart2.Init.BaudRate;
+}
+
+int UART_SetFlowControl(UART_FlowControl_t mode) {
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    // Leaving XON/XOFF: release a host we throttled and let output held back by its XOFF drain
+    if (flow_mode == UART_FLOW_XONXOFF && mode != UART_FLOW_XONXOFF) {
+        taskENTER_CRITICAL();
+        if (rx_throttled) {
+            tx_control = UART_XON;
+        }
+        tx_paused = 0;
+        tx_kick();
+        taskEXIT_CRITICAL();
+    }
+    if (uart_quiesce() != 0) {
+        return -1;
+    }
+
+    /* Hardware mode: CTS on PA0 (AF7) gates the transmitter. RTS on PA1 is
+     * driven as a plain output, because the USART's own RTS only reflects
+     * its one-byte data register, which DMA empties immediately; the real
+     * backlog is in the RX buffers.
+     */
+    if (mode == UART_FLOW_RTSCTS) {
+        GPIO_InitStruct.Pin = USART_CTS_Pin;
+        GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+        GPIO_InitStruct.Pull = GPIO_PULLUP;
+        GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+        GPIO_InitStruct.Alternate = GPIO_AF7_USART2;
+        HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+        HAL_GPIO_WritePin(GPIOA, USART_RTS_Pin, GPIO_PIN_RESET);
+        GPIO_InitStruct.Pin = USART_RTS_Pin;
+        GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+        GPIO_InitStruct.Pull = GPIO_NOPULL;
+        GPIO_InitStruct.Alternate = 0;
+        HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+        SET_BIT(huart2.Instance->CR3, USART_CR3_CTSE);
+        huart2.Init.HwFlowCtl = UART_HWCONTROL_CTS;
+    } else {
+        if (flow_mode == UART_FLOW_RTSCTS) {
+            HAL_GPIO_DeInit(GPIOA, USART_CTS_Pin | USART_RTS_Pin);
+        }
+        CLEAR_BIT(huart2.Instance->CR3, USART_CR3_CTSE);
+        huart2.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+    }
+
+    flow_mode = mode;
+    rx_throttled = 0;
+    tx_paused = 0;
+    __HAL_UART_ENABLE(&huart2);
+    return 0;
+}
+
+UART_FlowControl_t UART_GetFlowControl(void) {
+    return flow_mode;
+}
+
+void UART_FlowUpdate(uint32_t used, uint32_t capacity) {
+    /* Called by the RX path with the current backlog. Crossing the high
+     * watermark asks the host to stop, dropping below the low one lets it
+     * resume; the gap between them absorbs what is already in flight.
+     */
+    uint8_t stop;
+
+    if (flow_mode == UART_FLOW_NONE) {
+        return;
+    }
+    // An XON/XOFF inside an RPC frame would corrupt it: in-band flow control waits for text mode
+    if (flow_mode == UART_FLOW_XONXOFF && rpc_active()) {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    if (!rx_throttled && used * 100 >= capacity * UART_FLOW_HIGH_PCT) {
+        stop = 1;
+    } else if (rx_throttled && used * 100 <= capacity * UART_FLOW_LOW_PCT) {
+        stop = 0;
+    } else {
+        taskEXIT_CRITICAL();
+        return;
+    }
+
+    rx_throttled = stop;
+    if (flow_mode == UART_FLOW_RTSCTS) {
+        HAL_GPIO_WritePin(GPIOA, USART_RTS_Pin, stop ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    } else {
+        tx_control = stop ? UART_XOFF : UART_XON;
+        tx_kick();
+    }
+    taskEXIT_CRITICAL();
+}
+
+int UART_RxThrottled(void) {
+    return rx_throttled;
+}
+
+int UART_TxPaused(void) {
+    return tx_paused;
+}
+
+static void uart_sink(void *ctx, const char *data, size_t len) {
+    (void)ctx;
+    UART_Write((const uint8_t *)data, len);
+}
+
 void UART_Print(const char *format, ...) {
-    char buffer[256];
     va_list args;
     va_start(args, format);
-    vsnprintf(buffer, 256, format, args);
+    fmt_vprintf(uart_sink, NULL, format, args);
     va_end(args);
-    
-    HAL_UART_Transmit(&huart2, (uint8_t *)buffer, strlen(buffer), HAL_MAX_DELAY);
 }
 
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+    // Retire the span that just went out and chain the next one
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    UBaseType_t isr_mask = taskENTER_CRITICAL_FROM_ISR();
+
+    ring_commit(&tx_ring, tx_span);
+    uart_stats.tx_bytes += tx_span;
+    tx_span = 0;
+    tx_kick();
+
+    taskEXIT_CRITICAL_FROM_ISR(isr_mask);
+
+    xSemaphoreGiveFromISR(xTxSpaceSemaphore, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+#if UART_RX_MODE == UART_RX_MODE_DMA
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
+    /* Size is the current write position of the DMA stream inside
+     * rx_dma_buffer (UART_RX_BUFFER_SIZE on transfer complete).
+     * Publish it and wake UARTRxTask once for the whole burst.
+     */
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint16_t head = Size % UART_RX_BUFFER_SIZE;
+    uint16_t unread = (uint16_t)(rx_head - rx_tail + UART_RX_BUFFER_SIZE) % UART_RX_BUFFER_SIZE;
+    uint16_t received = (uint16_t)(head - rx_head + UART_RX_BUFFER_SIZE) % UART_RX_BUFFER_SIZE;
+
+    // The DMA never stops, so a reader that falls a full buffer behind loses data
+    // (a lower bound: a lap missed between two events is not seen)
+    if (unread + received >= UART_RX_BUFFER_SIZE) {
+        uart_stats.rx_dropped += unread + received - (UART_RX_BUFFER_SIZE - 1);
+    }
+
+    uart_stats.rx_bytes += received;
+    rx_note_level(unread + received);
+    rx_head = head;
+
+    vTaskNotifyGiveFromISR(xUARTRxTaskHandle, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+#elif UART_RX_MODE == UART_RX_MODE_LL
+#if UART_TX_MODE == UART_TX_MODE_IT
+// TXE: send a pending XON/XOFF or the next queued byte, or disarm once there is nothing to send
+static void tx_irq(USART_TypeDef *usart) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    UBaseType_t isr_mask = taskENTER_CRITICAL_FROM_ISR();
+    const uint8_t *span;
+    int wake = 0;
+
+    if (tx_control != 0) {
+        LL_USART_TransmitData8(usart, tx_control);
+        tx_control = 0;
+    } else if (!tx_paused && ring_peek_span(&tx_ring, &span) > 0) {
+        LL_USART_TransmitData8(usart, *span);
+        ring_commit(&tx_ring, 1);
+        uart_stats.tx_bytes++;
+        wake = (uart_stats.tx_bytes % TX_IT_WAKE_BYTES) == 0;
+    } else {
+        LL_USART_DisableIT_TXE(usart);
+        tx_span = 0;
+        wake = 1;
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR(isr_mask);
+
+    if (wake) {
+        xSemaphoreGiveFromISR(xTxSpaceSemaphore, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+}
+#endif
+
+void UART_LL_IRQHandler(void) {
+    /* Hot path: one SR read, one DR read, one store. Reading SR then DR also
+     * clears ORE/NE/FE, so errors need no separate handling. UARTRxTask is
+     * only notified for the first byte into an empty buffer; it drains until
+     * empty before blocking, so later bytes of a burst ride on that wakeup.
+     */
+    USART_TypeDef *usart = huart2.Instance;
+    uint32_t sr = LL_USART_ReadReg(usart, SR);
+
+    if (sr & (USART_SR_RXNE | USART_SR_ORE)) {
+        uint8_t c = LL_USART_ReceiveData8(usart);
+        uint16_t head = rx_head;
+        uint16_t next = (head + 1) & (UART_RX_BUFFER_SIZE - 1);
+
+        if (sr & (USART_SR_ORE | USART_SR_FE | USART_SR_NE | USART_SR_PE)) {
+            uart_stats.overrun_errors += (sr & USART_SR_ORE) != 0;
+            uart_stats.framing_errors += (sr & USART_SR_FE) != 0;
+            uart_stats.noise_errors += (sr & USART_SR_NE) != 0;
+            uart_stats.parity_errors += (sr & USART_SR_PE) != 0;
+        }
+        if (next == rx_tail) {
+            uart_stats.rx_dropped++;
+        } else {
+            rx_dma_buffer[head] = c;
+            rx_head = next;
+            uart_stats.rx_bytes++;
+            rx_note_level((next - rx_tail) & (UART_RX_BUFFER_SIZE - 1));
+
+            if (head == rx_tail) {
+                BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+                vTaskNotifyGiveFromISR(xUARTRxTaskHandle, &xHigherPriorityTaskWoken);
+                portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+            }
+        }
+    }
+
+#if UART_TX_MODE == UART_TX_MODE_IT
+    if ((sr & USART_SR_TXE) && LL_USART_IsEnabledIT_TXE(usart)) {
+        tx_irq(usart);
+    }
+#else
+    // End of a TX DMA transfer (TCIE is set by the HAL) stays on the HAL path
+    if ((sr & USART_SR_TC) && LL_USART_IsEnabledIT_TC(usart)) {
+        HAL_UART_IRQHandler(&huart2);
+    }
+#endif
+}
+#else
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
-    /* Notify receiver task to put char into the buffer
-     * Signal with semaphore to UARTRxTask
-     * Yield to higer priority task
+    /* Publish the byte that just landed at rx_head and notify UARTRxTask.
+     * If the landing buffer is full the byte is counted as lost and the
+     * same slot is re-armed.
      */
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint16_t head = (rx_head + 1) % UART_RX_BUFFER_SIZE;
+
+    if (head == rx_tail) {
+        uart_stats.rx_dropped++;
+        head = rx_head;
+    } else {
+        rx_head = head;
+        uart_stats.rx_bytes++;
+        rx_note_level((head - rx_tail) & (UART_RX_BUFFER_SIZE - 1));
+    }
 
-    xSemaphoreGiveFromISR(xBinarySemaphore, &xHigherPriorityTaskWoken);
-    HAL_UART_Receive_IT(huart, &chrx, 1);
+    vTaskNotifyGiveFromISR(xUARTRxTaskHandle, &xHigherPriorityTaskWoken);
+    HAL_UART_Receive_IT(huart, &rx_dma_buffer[head], 1);
 
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+#endif
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+    /* Blocking errors (overrun, DMA) abort the reception and leave RxState READY.
+     * Let UARTRxTask re-arm it after draining, so rx_head/rx_tail are never
+     * reset underneath the reader. In LL mode the HAL does not own reception,
+     * so only TX errors get here.
+     */
+    uint32_t err = huart->ErrorCode;
+
+    if (huart->Instance != USART2) {
+        return;
+    }
 
-    // old implementation
-    //buffer_putc(&rx_buffer, chrx);
-    //HAL_UART_Receive_IT(UART_GetHandle(), &chrx, 1);
-}
\ No newline at end of file
+    uart_stats.overrun_errors += (err & HAL_UART_ERROR_ORE) != 0;
+    uart_stats.framing_errors += (err & HAL_UART_ERROR_FE) != 0;
+    uart_stats.noise_errors += (err & HAL_UART_ERROR_NE) != 0;
+    uart_stats.parity_errors += (err & HAL_UART_ERROR_PE) != 0;
+    uart_stats.dma_errors += (err & HAL_UART_ERROR_DMA) != 0;
+
+    // A TX DMA error ends the transfer without a TxCplt; resend the pending span
+    if (huart->gState == HAL_UART_STATE_READY && tx_span != 0) {
+        tx_span = 0;
+        tx_kick();
+    }
+
+#if UART_RX_MODE != UART_RX_MODE_LL
+    if (huart->RxState == HAL_UART_STATE_READY) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        rx_restart = 1;
+        vTaskNotifyGiveFromISR(xUARTRxTaskHandle, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+#endif
+}
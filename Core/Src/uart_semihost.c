@@ -0,0 +1,240 @@
+#include "uart_driver.h"
+#include "ring_buffer.h"
+#include "fmt.h"
+#include "main.h"
+#include <stdarg.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+/* uart_driver.h over ARM semihosting (SHELL_SEMIHOSTING), for QEMU
+ * -semihosting or a debugger: output through _write() (SYS_WRITE), input
+ * through _read() (SYS_READC), both in syscalls.c. USART2 is left alone.
+ *
+ * A trap stops the core for as long as the debugger takes to serve it, so
+ * output is collected in a line buffer and written once per line, when the
+ * buffer fills, or when the input side is about to wait.
+ *
+ * SYS_READC blocks the whole core until a key arrives, so it is called from
+ * a task at idle priority: input is only read once every other task has
+ * nothing left to do. Before each read the pending partial line (prompt,
+ * echo) is written. A command that never blocks cannot be stopped with
+ * Ctrl+C, since nothing is read while it runs. Baud rate and flow control
+ * are only recorded for the commands that show them.
+ */
+
+#define SEMIHOST_LINE_SIZE  128
+
+int _write(int file, char *ptr, int len);   // syscalls.c
+int _read(int file, char *ptr, int len);
+
+UART_RxProfile_t uart_rx_profile;
+static UART_Stats_t uart_stats;
+static uint32_t profile_rx_base;
+static uint32_t uart_baud = 115200;
+static UART_FlowControl_t flow_mode = UART_FLOW_DEFAULT;
+extern TaskHandle_t xUARTRxTaskHandle;
+
+static char tx_line[SEMIHOST_LINE_SIZE];
+static size_t tx_len;
+static SemaphoreHandle_t xTxMutex = NULL;
+
+// Filled by the reader task, drained by UARTRxTask through UART_Read()
+static uint8_t rx_storage[UART_RX_BUFFER_SIZE];
+static RingBuffer_t rx_ring = { rx_storage, UART_RX_BUFFER_SIZE - 1, 0, 0 };
+
+void UART_Init(void) {
+    xTxMutex = xSemaphoreCreateMutex();
+}
+
+// Write out the buffered line; caller holds xTxMutex
+static void tx_flush_locked(void) {
+    int n;
+
+    if (tx_len == 0) {
+        return;
+    }
+    n = _write(1, tx_line, (int)tx_len);
+    if (n < 0) {
+        n = 0;
+    }
+    uart_stats.tx_bytes += (uint32_t)n;
+    uart_stats.tx_dropped += (uint32_t)(tx_len - (size_t)n);
+    tx_len = 0;
+}
+
+size_t UART_Write(const uint8_t *data, size_t len) {
+    size_t sent = 0;
+
+    // Interrupts cannot wait for the line buffer: their output is dropped
+    if (__get_IPSR() != 0) {
+        uart_stats.tx_dropped += len;
+        return 0;
+    }
+
+    xSemaphoreTake(xTxMutex, portMAX_DELAY);
+    while (sent < len) {
+        const uint8_t *nl = memchr(data + sent, '\n', len - sent);
+        size_t chunk = (nl != NULL) ? (size_t)(nl - (data + sent)) + 1 : len - sent;
+
+        if (chunk > sizeof(tx_line) - tx_len) {
+            chunk = sizeof(tx_line) - tx_len;
+            nl = NULL;
+        }
+        memcpy(&tx_line[tx_len], data + sent, chunk);
+        tx_len += chunk;
+        sent += chunk;
+        if (tx_len > uart_stats.tx_high_water) {
+            uart_stats.tx_high_water = (uint16_t)tx_len;
+        }
+        if (nl != NULL || tx_len == sizeof(tx_line)) {
+            tx_flush_locked();
+        }
+    }
+    xSemaphoreGive(xTxMutex);
+    return sent;
+}
+
+int UART_Flush(uint32_t timeout_ms) {
+    (void)timeout_ms;
+
+    xSemaphoreTake(xTxMutex, portMAX_DELAY);
+    tx_flush_locked();
+    xSemaphoreGive(xTxMutex);
+    return 0;
+}
+
+static void semihost_rx_task(void *pvParameters) {
+    char c;
+
+    (void)pvParameters;
+    while (1) {
+        // The core stops inside SYS_READC: show what is waiting first
+        UART_Flush(0);
+        if (_read(0, &c, 1) != 1) {
+            continue;
+        }
+
+        // UARTRxTask drains the ring; wait for it rather than drop keys
+        while (ring_putc(&rx_ring, (uint8_t)c) != 0) {
+            vTaskDelay(1);
+        }
+        uart_stats.rx_bytes++;
+        if (ring_count(&rx_ring) > uart_stats.rx_high_water) {
+            uart_stats.rx_high_water = (uint16_t)ring_count(&rx_ring);
+        }
+        xTaskNotifyGive(xUARTRxTaskHandle);
+    }
+}
+
+void UART_StartReceive(void) {
+    xTaskCreate(semihost_rx_task, "SemiRx", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY, NULL);
+}
+
+size_t UART_RxPending(void) {
+    return ring_count(&rx_ring);
+}
+
+size_t UART_Read(uint8_t *dst, size_t len) {
+    return ring_read(&rx_ring, dst, (uint32_t)len);
+}
+
+void UART_SetTxPolicy(UART_TxPolicy_t policy, uint32_t timeout_ms) {
+    (void)policy;
+    (void)timeout_ms;
+}
+
+uint32_t UART_GetTxDropped(void) {
+    return uart_stats.tx_dropped;
+}
+
+static void uart_sink(void *ctx, const char *data, size_t len) {
+    (void)ctx;
+    UART_Write((const uint8_t *)data, len);
+}
+
+void UART_Print(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    fmt_vprintf(uart_sink, NULL, format, args);
+    va_end(args);
+}
+
+// Same arithmetic as uart_driver.c, so baud reports the BRR USART2 would use
+int UART_CalcBaud(uint32_t baud, UART_BaudConfig_t *cfg) {
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+    uint32_t div;
+
+    if (baud == 0) {
+        return -1;
+    }
+
+    div = (pclk + baud / 2) / baud;
+    if (div >= 16 && div <= 0xFFFF) {
+        cfg->over8 = 0;
+        cfg->brr = (uint16_t)div;
+    } else if (div >= 8 && div < 16) {
+        cfg->over8 = 1;
+        cfg->brr = (uint16_t)(((div >> 3) << 4) | (div & 0x7));
+    } else {
+        return -1;
+    }
+
+    cfg->baud = baud;
+    cfg->actual = pclk / div;
+    cfg->error_ppm = (int32_t)(((int64_t)cfg->actual - baud) * 1000000 / baud);
+    return 0;
+}
+
+int UART_SetBaud(uint32_t baud, UART_BaudConfig_t *cfg) {
+    UART_BaudConfig_t local;
+
+    if (cfg == NULL) {
+        cfg = &local;
+    }
+    if (UART_CalcBaud(baud, cfg) != 0) {
+        return -1;
+    }
+    uart_baud = baud;
+    return 0;
+}
+
+uint32_t UART_GetBaud(void) {
+    return uart_baud;
+}
+
+int UART_SetFlowControl(UART_FlowControl_t mode) {
+    flow_mode = mode;
+    return 0;
+}
+
+UART_FlowControl_t UART_GetFlowControl(void) {
+    return flow_mode;
+}
+
+void UART_FlowUpdate(uint32_t used, uint32_t capacity) {
+    (void)used;
+    (void)capacity;
+}
+
+int UART_RxThrottled(void) {
+    return 0;
+}
+
+int UART_TxPaused(void) {
+    return 0;
+}
+
+const UART_RxProfile_t* UART_GetRxProfile(void) {
+    uart_rx_profile.rx_bytes = uart_stats.rx_bytes - profile_rx_base;
+    return &uart_rx_profile;
+}
+
+void UART_ResetRxProfile(void) {
+    profile_rx_base = uart_stats.rx_bytes;
+}
+
+const UART_Stats_t* UART_GetStats(void) {
+    return &uart_stats;
+}
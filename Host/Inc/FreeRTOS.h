@@ -0,0 +1,38 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Host port: the part of the FreeRTOS API the shell engine uses, on top of
+ * POSIX threads (Host/Src/host_freertos.c). One tick is one millisecond of
+ * CLOCK_MONOTONIC. Tasks are threads and priorities are ignored, so code
+ * that relies on priority for mutual exclusion must not be built here.
+ */
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define configSTACK_DEPTH_TYPE                  uint16_t
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS 1
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdFAIL              0
+#define pdPASS              1
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+// One recursive lock stands in for disabling interrupts
+void vPortEnterCritical(void);
+void vPortExitCritical(void);
+#define taskENTER_CRITICAL()    vPortEnterCritical()
+#define taskEXIT_CRITICAL()     vPortExitCritical()
+
+// Incremented whenever a task blocks, as traceTASK_SWITCHED_IN does on target
+extern volatile uint32_t ulContextSwitchCount;
+
+#endif /* HOST_FREERTOS_H */
@@ -0,0 +1,50 @@
+#ifndef HOST_CORE_CM4_H
+#define HOST_CORE_CM4_H
+
+#include <stdint.h>
+
+/* Host port stand-in for the CMSIS Cortex-M4 core header.
+ *
+ * stm32f401xe.h includes "core_cm4.h" for the register qualifiers and the
+ * core peripherals; on the host this file is found first. It provides the
+ * qualifiers and the few intrinsics the shell engine calls, so no ARM
+ * assembly is compiled. Core peripherals (SCB, NVIC, DWT...) do not exist
+ * here; dwt.h has its own host version.
+ */
+
+#ifdef __cplusplus
+  #define   __I     volatile
+#else
+  #define   __I     volatile const
+#endif
+#define     __O     volatile
+#define     __IO    volatile
+#define     __IM    volatile const
+#define     __OM    volatile
+#define     __IOM   volatile
+
+#ifndef __STATIC_INLINE
+  #define __STATIC_INLINE   static inline
+#endif
+#ifndef __ASM
+  #define __ASM             __asm
+#endif
+
+__STATIC_INLINE void __NOP(void) {}
+__STATIC_INLINE void __DSB(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+__STATIC_INLINE void __DMB(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+__STATIC_INLINE void __ISB(void) {}
+__STATIC_INLINE void __enable_irq(void) {}
+__STATIC_INLINE void __disable_irq(void) {}
+
+// Thread mode, never in a handler
+__STATIC_INLINE uint32_t __get_IPSR(void) {
+    return 0;
+}
+
+// Stack pointer of the calling task, wide enough for a host address
+__STATIC_INLINE uintptr_t __get_PSP(void) {
+    return (uintptr_t)__builtin_frame_address(0);
+}
+
+#endif /* HOST_CORE_CM4_H */
@@ -0,0 +1,26 @@
+#ifndef DWT_H
+#define DWT_H
+
+#include "main.h"
+#include <stdint.h>
+#include <time.h>
+
+/* Host port of the DWT cycle counter: CLOCK_MONOTONIC scaled to
+ * SystemCoreClock, so "cycles" are what the host time would be at the
+ * target clock and convert back to time the same way.
+ */
+
+static inline void DWT_Init(void) {
+}
+
+static inline void DWT_Enable(void) {
+}
+
+static inline uint32_t DWT_GetCycles(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec) * (SystemCoreClock / 1000000u) / 1000u);
+}
+
+#endif /* DWT_H */
@@ -0,0 +1,58 @@
+#ifndef HOST_PORT_H
+#define HOST_PORT_H
+
+#include <stdint.h>
+#include "main.h"
+
+/* Host (Linux) port of the shell.
+ *
+ * The shell engine (Core/Src/shell*.c, fmt.c, ring_buffer.c, rpc.c) is
+ * compiled unchanged and linked against Host/Src instead of the HAL, the
+ * UART driver and the FreeRTOS kernel:
+ *
+ *   host_main.c      process entry, pseudo-terminal or stdio, RX and shell tasks
+ *   host_freertos.c  tasks, notifications, timers on POSIX threads
+ *   host_uart.c      uart_driver.h API over a file descriptor
+ *   host_hal.c       HAL calls the shell makes
+ *   host_periph.c    register model behind GPIOA, RCC, USART2...
+ *
+ * Peripheral registers are RAM structs (see stm32f4xx.h here) holding the
+ * values the board has after start-up. Writes with a side effect in
+ * hardware are followed by the matching host_* call, which applies it.
+ */
+
+// Threads get real stacks: host libc and 64-bit frames need far more than the target's words
+#define HOST_STACK_SIZE     (256u * 1024u)
+
+// Instances behind GPIOA, RCC, USART2... on the host
+extern GPIO_TypeDef host_gpioa;
+extern GPIO_TypeDef host_gpiob;
+extern GPIO_TypeDef host_gpioc;
+extern GPIO_TypeDef host_gpiod;
+extern GPIO_TypeDef host_gpioe;
+extern GPIO_TypeDef host_gpioh;
+extern RCC_TypeDef host_rcc;
+extern USART_TypeDef host_usart1;
+extern USART_TypeDef host_usart2;
+extern USART_TypeDef host_usart6;
+extern TIM_TypeDef host_tim1;
+extern CRC_TypeDef host_crc;
+
+// Power-on reset values, then what the firmware's init code configures
+void host_periph_reset(void);
+void host_periph_boot(void);
+
+// After a BSRR write: apply it to ODR, clear it, and reflect outputs in IDR
+void host_gpio_update(GPIO_TypeDef *gpio);
+
+// Transmitter busy (TC clear) or idle; bytes received (DR holds the last one)
+void host_usart_tx(USART_TypeDef *usart, int busy);
+void host_usart_rx(USART_TypeDef *usart, const uint8_t *data, uint32_t len);
+
+// File descriptor the UART writes to
+extern int host_tx_fd;
+
+// RX path: count bytes received, as the USART interrupt does on target
+void host_uart_received(const uint8_t *data, uint32_t len);
+
+#endif /* HOST_PORT_H */
@@ -0,0 +1,38 @@
+#ifndef HOST_STM32F4XX_H
+#define HOST_STM32F4XX_H
+
+/* Host port: the device header as on target, with every peripheral
+ * instance the shell touches pointed at a RAM struct (host_port.h) instead
+ * of its MMIO address.
+ */
+
+#include_next "stm32f4xx.h"
+#include "host_port.h"
+
+#undef GPIOA
+#undef GPIOB
+#undef GPIOC
+#undef GPIOD
+#undef GPIOE
+#undef GPIOH
+#undef RCC
+#undef USART1
+#undef USART2
+#undef USART6
+#undef TIM1
+#undef CRC
+
+#define GPIOA   (&host_gpioa)
+#define GPIOB   (&host_gpiob)
+#define GPIOC   (&host_gpioc)
+#define GPIOD   (&host_gpiod)
+#define GPIOE   (&host_gpioe)
+#define GPIOH   (&host_gpioh)
+#define RCC     (&host_rcc)
+#define USART1  (&host_usart1)
+#define USART2  (&host_usart2)
+#define USART6  (&host_usart6)
+#define TIM1    (&host_tim1)
+#define CRC     (&host_crc)
+
+#endif /* HOST_STM32F4XX_H */
@@ -0,0 +1,40 @@
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef struct HostTask_s *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef enum {
+    eRunning,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid
+} eTaskState;
+
+typedef struct {
+    TaskHandle_t xHandle;
+    const char *pcTaskName;
+    eTaskState eCurrentState;
+    StackType_t *pxStackBase;                   // lowest address of the stack block
+    configSTACK_DEPTH_TYPE usStackHighWaterMark;
+} TaskStatus_t;
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, configSTACK_DEPTH_TYPE depth,
+                       void *arg, UBaseType_t priority, TaskHandle_t *handle);
+void vTaskStartScheduler(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(TickType_t ticks);
+void vTaskGetInfo(TaskHandle_t task, TaskStatus_t *status, BaseType_t get_free_stack, eTaskState state);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait);
+
+void* pvTaskGetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t index);
+void vTaskSetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t index, void *value);
+
+#endif /* HOST_TASK_H */
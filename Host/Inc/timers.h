@@ -0,0 +1,20 @@
+#ifndef HOST_TIMERS_H
+#define HOST_TIMERS_H
+
+#include "FreeRTOS.h"
+
+/* Software timers. Callbacks run one at a time on a daemon thread, like
+ * the FreeRTOS timer service task; the block times are ignored.
+ */
+
+typedef struct HostTimer_s *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload,
+                           void *id, TimerCallbackFunction_t callback);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t wait);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t wait);
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t wait);
+void* pvTimerGetTimerID(TimerHandle_t timer);
+
+#endif /* HOST_TIMERS_H */
@@ -0,0 +1,340 @@
+#define _GNU_SOURCE
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "host_port.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+struct HostTask_s {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    const char *name;
+    void *stack;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify;
+    void *tls[configNUM_THREAD_LOCAL_STORAGE_POINTERS];
+};
+
+struct HostTimer_s {
+    const char *name;
+    TickType_t period;
+    UBaseType_t auto_reload;
+    void *id;
+    TimerCallbackFunction_t callback;
+    uint8_t active;
+    struct timespec due;
+    struct HostTimer_s *next;
+};
+
+volatile uint32_t ulContextSwitchCount;
+
+static __thread TaskHandle_t current;
+static pthread_mutex_t critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static pthread_once_t timer_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond;
+static struct HostTimer_s *timers;
+
+// Condition variables time out against CLOCK_MONOTONIC, like the tick count
+static void cond_init(pthread_cond_t *cond) {
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static void after_ticks(struct timespec *ts, TickType_t ticks) {
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += ticks / 1000u;
+    ts->tv_nsec += (long)(ticks % 1000u) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static int before(const struct timespec *a, const struct timespec *b) {
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+void vPortEnterCritical(void) {
+    pthread_mutex_lock(&critical);
+}
+
+void vPortExitCritical(void) {
+    pthread_mutex_unlock(&critical);
+}
+
+// Tasks
+
+static void* task_entry(void *arg) {
+    current = arg;
+    current->fn(current->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, configSTACK_DEPTH_TYPE depth,
+                       void *arg, UBaseType_t priority, TaskHandle_t *handle) {
+    TaskHandle_t task = calloc(1, sizeof(*task));
+    pthread_attr_t attr;
+
+    (void)depth;
+    (void)priority;
+
+    if (task == NULL || posix_memalign(&task->stack, (size_t)sysconf(_SC_PAGESIZE), HOST_STACK_SIZE) != 0) {
+        free(task);
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    task->name = name;
+    pthread_mutex_init(&task->lock, NULL);
+    cond_init(&task->cond);
+
+    // The handle is published before the task can run, as on target
+    if (handle != NULL) {
+        *handle = task;
+    }
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, task->stack, HOST_STACK_SIZE);
+    if (pthread_create(&task->thread, &attr, task_entry, task) != 0) {
+        pthread_attr_destroy(&attr);
+        if (handle != NULL) {
+            *handle = NULL;
+        }
+        free(task->stack);
+        free(task);
+        return pdFAIL;
+    }
+    pthread_attr_destroy(&attr);
+    return pdPASS;
+}
+
+void vTaskStartScheduler(void) {
+    // The tasks already run; the caller just has to stay out of their way
+    while (1) {
+        pause();
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return current;
+}
+
+static TickType_t monotonic_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+// The tick count starts from 0 with the process, as from reset on the board
+static TickType_t tick_base;
+
+__attribute__((constructor)) static void tick_start(void) {
+    tick_base = monotonic_ms();
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return monotonic_ms() - tick_base;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    struct timespec ts = { (time_t)(ticks / 1000u), (long)(ticks % 1000u) * 1000000L };
+
+    ulContextSwitchCount++;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+void vTaskGetInfo(TaskHandle_t task, TaskStatus_t *status, BaseType_t get_free_stack, eTaskState state) {
+    (void)get_free_stack;
+
+    task = task != NULL ? task : current;
+    status->xHandle = task;
+    status->pcTaskName = task != NULL ? task->name : "main";
+    status->eCurrentState = state;
+    status->pxStackBase = task != NULL ? task->stack : NULL;
+    status->usStackHighWaterMark = 0;
+}
+
+// Notifications: a counting semaphore per task
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    pthread_mutex_lock(&task->lock);
+    task->notify++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait) {
+    TaskHandle_t task = current;
+    struct timespec due;
+    uint32_t value;
+
+    if (task == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&task->lock);
+    if (task->notify == 0 && wait != 0) {
+        ulContextSwitchCount++;
+        if (wait == portMAX_DELAY) {
+            while (task->notify == 0) {
+                pthread_cond_wait(&task->cond, &task->lock);
+            }
+        } else {
+            after_ticks(&due, wait);
+            while (task->notify == 0 && pthread_cond_timedwait(&task->cond, &task->lock, &due) != ETIMEDOUT) {
+            }
+        }
+    }
+    value = task->notify;
+    if (value != 0) {
+        task->notify = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+void* pvTaskGetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t index) {
+    task = task != NULL ? task : current;
+    if (task == NULL || index < 0 || index >= configNUM_THREAD_LOCAL_STORAGE_POINTERS) {
+        return NULL;
+    }
+    return task->tls[index];
+}
+
+void vTaskSetThreadLocalStoragePointer(TaskHandle_t task, BaseType_t index, void *value) {
+    task = task != NULL ? task : current;
+    if (task != NULL && index >= 0 && index < configNUM_THREAD_LOCAL_STORAGE_POINTERS) {
+        task->tls[index] = value;
+    }
+}
+
+// Timers: one daemon thread runs the callbacks of every timer as they fall due
+
+static void* timer_daemon(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&timer_lock);
+    while (1) {
+        struct HostTimer_s *next = NULL;
+        struct HostTimer_s *t;
+        struct timespec now;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        for (t = timers; t != NULL; t = t->next) {
+            if (!t->active) {
+                continue;
+            }
+            if (!before(&now, &t->due)) {
+                break;
+            }
+            if (next == NULL || before(&t->due, &next->due)) {
+                next = t;
+            }
+        }
+
+        if (t != NULL) {
+            // Due: re-arm from the due time so a periodic timer does not drift
+            if (t->auto_reload) {
+                t->due.tv_sec += t->period / 1000u;
+                t->due.tv_nsec += (long)(t->period % 1000u) * 1000000L;
+                if (t->due.tv_nsec >= 1000000000L) {
+                    t->due.tv_sec++;
+                    t->due.tv_nsec -= 1000000000L;
+                }
+                if (before(&t->due, &now)) {
+                    after_ticks(&t->due, t->period);
+                }
+            } else {
+                t->active = 0;
+            }
+            pthread_mutex_unlock(&timer_lock);
+            t->callback(t);
+            pthread_mutex_lock(&timer_lock);
+        } else if (next != NULL) {
+            pthread_cond_timedwait(&timer_cond, &timer_lock, &next->due);
+        } else {
+            pthread_cond_wait(&timer_cond, &timer_lock);
+        }
+    }
+    return NULL;
+}
+
+static void timer_service_start(void) {
+    pthread_t thread;
+
+    cond_init(&timer_cond);
+    pthread_create(&thread, NULL, timer_daemon, NULL);
+    pthread_detach(thread);
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload,
+                           void *id, TimerCallbackFunction_t callback) {
+    struct HostTimer_s *timer = calloc(1, sizeof(*timer));
+
+    if (timer == NULL || period == 0) {
+        free(timer);
+        return NULL;
+    }
+    pthread_once(&timer_once, timer_service_start);
+
+    timer->name = name;
+    timer->period = period;
+    timer->auto_reload = auto_reload;
+    timer->id = id;
+    timer->callback = callback;
+
+    pthread_mutex_lock(&timer_lock);
+    timer->next = timers;
+    timers = timer;
+    pthread_mutex_unlock(&timer_lock);
+    return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t wait) {
+    (void)wait;
+
+    pthread_mutex_lock(&timer_lock);
+    after_ticks(&timer->due, timer->period);
+    timer->active = 1;
+    pthread_cond_signal(&timer_cond);
+    pthread_mutex_unlock(&timer_lock);
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t wait) {
+    (void)wait;
+
+    pthread_mutex_lock(&timer_lock);
+    timer->active = 0;
+    pthread_mutex_unlock(&timer_lock);
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t wait) {
+    if (period == 0) {
+        return pdFAIL;
+    }
+    pthread_mutex_lock(&timer_lock);
+    timer->period = period;
+    pthread_mutex_unlock(&timer_lock);
+
+    // As on target, changing the period also starts a dormant timer
+    return xTimerStart(timer, wait);
+}
+
+void* pvTimerGetTimerID(TimerHandle_t timer) {
+    return timer->id;
+}
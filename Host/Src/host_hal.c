@@ -0,0 +1,95 @@
+#include "main.h"
+#include "host_port.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+// HSI until host_periph_boot() runs the firmware's clock setup, as system_stm32f4xx.c
+uint32_t SystemCoreClock = HSI_VALUE;
+
+// HPRE and PPREx fields as right shifts
+static const uint8_t ahb_shift[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9 };
+static const uint8_t apb_shift[8] = { 0, 0, 0, 0, 1, 2, 3, 4 };
+
+uint32_t HAL_GetTick(void) {
+    return xTaskGetTickCount();
+}
+
+HAL_TickFreqTypeDef HAL_GetTickFreq(void) {
+    return HAL_TICK_FREQ_1KHZ;
+}
+
+void HAL_Delay(uint32_t Delay) {
+    vTaskDelay(pdMS_TO_TICKS(Delay));
+}
+
+uint32_t HAL_GetHalVersion(void) {
+    return 0x01080500u;                 // V1.8.5, the driver in Drivers/
+}
+
+uint32_t HAL_GetREVID(void) {
+    return 0x1000u;
+}
+
+uint32_t HAL_GetDEVID(void) {
+    return 0x433u;                      // STM32F401xD/E
+}
+
+// Clock frequencies decoded from the RCC model, as the HAL does from the real registers
+uint32_t HAL_RCC_GetSysClockFreq(void) {
+    uint32_t pllcfgr = RCC->PLLCFGR;
+    uint32_t src;
+    uint32_t m;
+
+    switch (RCC->CFGR & RCC_CFGR_SWS) {
+        case RCC_CFGR_SWS_HSE:
+            return HSE_VALUE;
+        case RCC_CFGR_SWS_PLL:
+            src = (pllcfgr & RCC_PLLCFGR_PLLSRC) ? HSE_VALUE : HSI_VALUE;
+            m = (pllcfgr & RCC_PLLCFGR_PLLM) >> RCC_PLLCFGR_PLLM_Pos;
+            if (m == 0) {
+                return 0;
+            }
+            return (uint32_t)((uint64_t)src * ((pllcfgr & RCC_PLLCFGR_PLLN) >> RCC_PLLCFGR_PLLN_Pos) / m /
+                              ((((pllcfgr & RCC_PLLCFGR_PLLP) >> RCC_PLLCFGR_PLLP_Pos) + 1u) * 2u));
+        default:
+            return HSI_VALUE;
+    }
+}
+
+void SystemCoreClockUpdate(void) {
+    SystemCoreClock = HAL_RCC_GetSysClockFreq() >> ahb_shift[(RCC->CFGR & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos];
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void) {
+    return SystemCoreClock;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) {
+    return HAL_RCC_GetHCLKFreq() >> apb_shift[(RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos];
+}
+
+uint32_t HAL_RCC_GetPCLK2Freq(void) {
+    return HAL_RCC_GetHCLKFreq() >> apb_shift[(RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos];
+}
+
+// Same register accesses as the HAL, then the model applies the BSRR write
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+    if (PinState != GPIO_PIN_RESET) {
+        GPIOx->BSRR = GPIO_Pin;
+    } else {
+        GPIOx->BSRR = (uint32_t)GPIO_Pin << 16;
+    }
+    host_gpio_update(GPIOx);
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) {
+    uint32_t odr = GPIOx->ODR;
+
+    GPIOx->BSRR = ((odr & GPIO_Pin) << 16) | (~odr & GPIO_Pin);
+    host_gpio_update(GPIOx);
+}
+
+void Error_Handler(void) {
+    while (1) {
+    }
+}
@@ -0,0 +1,268 @@
+#define _GNU_SOURCE
+#include "main.h"
+#include "shell.h"
+#include "shell_jobs.h"
+#include "shell_bench.h"
+#include "rpc.h"
+#include "host_port.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+/* shell-host [-s] [-b file [-n runs]]
+ *
+ * Runs the shell on a new pseudo-terminal and prints its name; attach with
+ * "screen /dev/pts/N" or any serial client. With -s it talks over stdin and
+ * stdout instead, for scripts and pipes, and exits once stdin ends and the
+ * input has been processed. -b replays a recorded keystroke file through
+ * the input path, as keybench does with its built-in streams, prints the
+ * figures and exits.
+ *
+ * The tasks mirror the firmware's: HostRx plays UARTRxTask (read, spot
+ * Ctrl+C, fill rx_buffer), SHELL runs ProcessInput's loop.
+ */
+
+TaskHandle_t xShellTaskHandle;
+static TaskHandle_t xRxTaskHandle;
+
+static int rx_fd = STDIN_FILENO;
+static volatile uint8_t rx_eof;
+static volatile uint8_t rx_stalled;
+
+static const char *bench_file;
+static uint32_t bench_runs = SHELL_BENCH_RUNS;
+
+static struct termios saved_termios;
+static int termios_saved;
+
+static void restore_terminal(void) {
+    if (termios_saved) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+    }
+}
+
+// Keystrokes must reach the shell one by one and unechoed, as over a serial line
+static void raw_stdin(void) {
+    struct termios raw;
+
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved_termios) != 0) {
+        return;
+    }
+    termios_saved = 1;
+    atexit(restore_terminal);
+    raw = saved_termios;
+    cfmakeraw(&raw);
+    raw.c_oflag |= OPOST | ONLCR;       // keep our own diagnostics readable
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+}
+
+static int open_pty(void) {
+    struct termios raw;
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    int slave;
+
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("shell-host: pseudo-terminal");
+        return -1;
+    }
+
+    // Hold the slave open so the master does not see hangups between clients
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        perror("shell-host: pseudo-terminal");
+        return -1;
+    }
+    tcgetattr(slave, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(slave, TCSANOW, &raw);
+
+    fprintf(stderr, "shell-host: listening on %s\n", ptsname(master));
+    return master;
+}
+
+// Terminals send CR for Enter; the shell takes LF, so map CR and CR LF to one LF. Returns 0 to drop c
+static int enter_to_lf(uint8_t *c, uint8_t *last_cr) {
+    if (*c == '\n' && *last_cr) {
+        *last_cr = 0;
+        return 0;
+    }
+    *last_cr = (*c == '\r');
+    if (*c == '\r') {
+        *c = '\n';
+    }
+    return 1;
+}
+
+static void HostRxTask(void *pvParameters) {
+    uint8_t buf[256];
+    uint8_t last_cr = 0;
+
+    (void)pvParameters;
+
+    while (1) {
+        ssize_t n = read(rx_fd, buf, sizeof(buf));
+
+        if (n <= 0) {
+            rx_eof = 1;
+            xTaskNotifyGive(xShellTaskHandle);
+            return;
+        }
+        host_uart_received(buf, (uint32_t)n);
+
+        for (ssize_t i = 0; i < n; i++) {
+            uint8_t c = buf[i];
+
+            if (!enter_to_lf(&c, &last_cr)) {
+                continue;
+            }
+            if (c == 0x03 && !rpc_active()) {
+                shell_interrupt();
+            }
+
+            // rx_buffer full: wait for the shell to drain it instead of dropping input
+            while (ring_putc(&rx_buffer, c) != 0) {
+                rx_stalled = 1;
+                xTaskNotifyGive(xShellTaskHandle);
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            }
+        }
+        xTaskNotifyGive(xShellTaskHandle);
+    }
+}
+
+static void ProcessInput(void *pvParameters) {
+    (void)pvParameters;
+
+    shell_init();
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (process_input() > 0) {
+            if (rx_stalled) {
+                rx_stalled = 0;
+                xTaskNotifyGive(xRxTaskHandle);
+            }
+        }
+        shell_poll();
+
+        if (rx_eof && ring_count(&rx_buffer) == 0) {
+            exit(0);
+        }
+    }
+}
+
+// -b: runs in place of ProcessInput, so commands in the recording see the usual shell task
+static void BenchTask(void *pvParameters) {
+    ShellBenchResult_t r = { 0 };
+    FILE *f = fopen(bench_file, "rb");
+    uint8_t *keys = NULL;
+    size_t len = 0;
+    size_t size = 0;
+    uint8_t last_cr = 0;
+    int ch;
+
+    (void)pvParameters;
+
+    if (f == NULL) {
+        perror(bench_file);
+        exit(1);
+    }
+    while ((ch = fgetc(f)) != EOF) {
+        uint8_t c = (uint8_t)ch;
+
+        if (!enter_to_lf(&c, &last_cr)) {
+            continue;
+        }
+        if (len == size) {
+            size = size ? size * 2 : 4096;
+            keys = realloc(keys, size);
+            if (keys == NULL) {
+                perror("shell-host");
+                exit(1);
+            }
+        }
+        keys[len++] = c;
+    }
+    fclose(f);
+
+    for (uint32_t run = 0; run < bench_runs; run++) {
+        shell_bench_replay(keys, len, NULL, &r);
+    }
+    shell_bench_header(bench_runs);
+    shell_bench_print(basename(bench_file), &r);
+    free(keys);
+    exit(0);
+}
+
+int shell_wait_input(uint32_t timeout_ms) {
+    return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) > 0;
+}
+
+void shell_wake(void) {
+    xTaskNotifyGive(xShellTaskHandle);
+}
+
+int main(int argc, char **argv) {
+    int use_stdio = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "sb:n:h")) != -1) {
+        switch (opt) {
+            case 's':
+                use_stdio = 1;
+                break;
+            case 'b':
+                bench_file = optarg;
+                break;
+            case 'n':
+                bench_runs = (uint32_t)strtoul(optarg, NULL, 0);
+                if (bench_runs > 0) {
+                    break;
+                }
+                /* fall through */
+            default:
+                fprintf(stderr, "usage: %s [-s] [-b file [-n runs]]\n"
+                                "  (default)  run on a new pseudo-terminal\n"
+                                "  -s         use stdin/stdout, exit at end of input\n"
+                                "  -b file    replay recorded keystrokes, report cost per input byte\n"
+                                "  -n runs    replays to average over (default %d)\n", argv[0], SHELL_BENCH_RUNS);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    // The board as the firmware's main() leaves it before the scheduler starts
+    host_periph_reset();
+    host_periph_boot();
+
+    if (bench_file != NULL) {
+        host_tx_fd = STDOUT_FILENO;
+        xTaskCreate(BenchTask, "SHELL", 512, NULL, 2, &xShellTaskHandle);
+        shell_jobs_init();
+        vTaskStartScheduler();
+        return 0;
+    }
+
+    if (use_stdio) {
+        raw_stdin();
+        rx_fd = STDIN_FILENO;
+        host_tx_fd = STDOUT_FILENO;
+    } else {
+        rx_fd = open_pty();
+        if (rx_fd < 0) {
+            return 1;
+        }
+        host_tx_fd = rx_fd;
+    }
+
+    xTaskCreate(ProcessInput, "SHELL", 512, NULL, 2, &xShellTaskHandle);
+    xTaskCreate(HostRxTask, "HostRx", 256, NULL, 3, &xRxTaskHandle);
+    shell_jobs_init();
+
+    vTaskStartScheduler();
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "main.h"
+#include "host_port.h"
+#include <string.h>
+
+/* Register model behind GPIOA, RCC, USART2... on the host. The instances
+ * are plain structs, so reads cost what they cost on target and anything
+ * can inspect them; the few writes that have side effects in silicon go
+ * through the host_* calls below, made by the HAL and UART stand-ins at the
+ * point where the hardware would react.
+ *
+ * Values follow RM0368 (STM32F401xB/C/D/E reference manual): reset values
+ * from the register descriptions, then the state SystemClock_Config(),
+ * HAL_MspInit(), GPIO_Init() and UART_Init() leave on a Nucleo-F401RE.
+ */
+
+GPIO_TypeDef host_gpioa;
+GPIO_TypeDef host_gpiob;
+GPIO_TypeDef host_gpioc;
+GPIO_TypeDef host_gpiod;
+GPIO_TypeDef host_gpioe;
+GPIO_TypeDef host_gpioh;
+RCC_TypeDef host_rcc;
+USART_TypeDef host_usart1;
+USART_TypeDef host_usart2;
+USART_TypeDef host_usart6;
+TIM_TypeDef host_tim1;
+CRC_TypeDef host_crc;
+
+#define GPIO_MODE_BITS(pin, mode)   ((uint32_t)(mode) << ((pin) * 2u))
+
+static void gpio_reset(GPIO_TypeDef *gpio, uint32_t moder, uint32_t ospeedr, uint32_t pupdr) {
+    memset(gpio, 0, sizeof(*gpio));
+    gpio->MODER = moder;
+    gpio->OSPEEDR = ospeedr;
+    gpio->PUPDR = pupdr;
+}
+
+static void usart_reset(USART_TypeDef *usart) {
+    memset(usart, 0, sizeof(*usart));
+    usart->SR = USART_SR_TXE | USART_SR_TC;
+}
+
+void host_periph_reset(void) {
+    // JTAG/SWD pins come up in AF mode with their pulls: PA13-15, PB3-4
+    gpio_reset(&host_gpioa, 0xA8000000u, 0x0C000000u, 0x64000000u);
+    gpio_reset(&host_gpiob, 0x00000280u, 0x000000C0u, 0x00000100u);
+    gpio_reset(&host_gpioc, 0, 0, 0);
+    gpio_reset(&host_gpiod, 0, 0, 0);
+    gpio_reset(&host_gpioe, 0, 0, 0);
+    gpio_reset(&host_gpioh, 0, 0, 0);
+
+    // Pins that read high at rest: SWDIO, JTDI, NJTRST pulled up; B1 has an external pull-up
+    host_gpioa.IDR = GPIO_PIN_13 | GPIO_PIN_15;
+    host_gpiob.IDR = GPIO_PIN_4;
+    host_gpioc.IDR = B1_Pin;
+
+    memset(&host_rcc, 0, sizeof(host_rcc));
+    host_rcc.CR = (16u << RCC_CR_HSITRIM_Pos) | RCC_CR_HSIRDY | RCC_CR_HSION;
+    host_rcc.PLLCFGR = 0x24003010u;
+    host_rcc.AHB1LPENR = 0x0061900Fu;
+    host_rcc.AHB2LPENR = 0x00000080u;
+    host_rcc.APB1LPENR = 0x10E2C80Fu;
+    host_rcc.APB2LPENR = 0x00077930u;
+    host_rcc.CSR = RCC_CSR_PORRSTF | RCC_CSR_PINRSTF | RCC_CSR_BORRSTF;
+    host_rcc.PLLI2SCFGR = 0x24003000u;
+
+    usart_reset(&host_usart1);
+    usart_reset(&host_usart2);
+    usart_reset(&host_usart6);
+
+    memset(&host_tim1, 0, sizeof(host_tim1));
+    host_tim1.ARR = 0xFFFFu;
+
+    memset(&host_crc, 0, sizeof(host_crc));
+    host_crc.DR = 0xFFFFFFFFu;
+
+    SystemCoreClock = HSI_VALUE;
+}
+
+void host_periph_boot(void) {
+    // SystemClock_Config(): HSI / 16 * 336 / 4 = 84 MHz, APB1 /2
+    host_rcc.PLLCFGR = (host_rcc.PLLCFGR & ~(RCC_PLLCFGR_PLLM | RCC_PLLCFGR_PLLN | RCC_PLLCFGR_PLLP |
+                                             RCC_PLLCFGR_PLLSRC | RCC_PLLCFGR_PLLQ)) |
+                       (16u << RCC_PLLCFGR_PLLM_Pos) | (336u << RCC_PLLCFGR_PLLN_Pos) |
+                       (1u << RCC_PLLCFGR_PLLP_Pos) | (7u << RCC_PLLCFGR_PLLQ_Pos);
+    host_rcc.CR |= RCC_CR_PLLON | RCC_CR_PLLRDY;
+    host_rcc.CFGR = RCC_CFGR_PPRE1_DIV2 | RCC_CFGR_SWS_PLL | RCC_CFGR_SW_PLL;
+    SystemCoreClockUpdate();
+
+    // HAL_MspInit(), GPIO_Init(), HAL_UART_MspInit()
+    host_rcc.APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+    host_rcc.APB1ENR |= RCC_APB1ENR_PWREN | RCC_APB1ENR_USART2EN;
+    host_rcc.AHB1ENR |= RCC_AHB1ENR_GPIOAEN | RCC_AHB1ENR_GPIOBEN | RCC_AHB1ENR_GPIOCEN |
+                        RCC_AHB1ENR_GPIOHEN | RCC_AHB1ENR_DMA1EN;
+
+    // LD2 push-pull output, low speed; PA2/PA3 AF7 very high speed, idle high
+    host_gpioa.MODER |= GPIO_MODE_BITS(5, 1) | GPIO_MODE_BITS(2, 2) | GPIO_MODE_BITS(3, 2);
+    host_gpioa.OSPEEDR |= GPIO_MODE_BITS(2, 3) | GPIO_MODE_BITS(3, 3);
+    host_gpioa.AFR[0] |= (GPIO_AF7_USART2 << (2 * 4)) | (GPIO_AF7_USART2 << (3 * 4));
+    host_gpioa.IDR |= USART_TX_Pin | USART_RX_Pin;
+
+    // UART_Init(): 115200 8N1 OVER16, RX by DMA with IDLE detection
+    host_usart2.BRR = (HAL_RCC_GetPCLK1Freq() + 115200u / 2u) / 115200u;
+    host_usart2.CR1 = USART_CR1_UE | USART_CR1_IDLEIE | USART_CR1_TE | USART_CR1_RE;
+    host_usart2.CR3 = USART_CR3_DMAR | USART_CR3_EIE;
+}
+
+void host_gpio_update(GPIO_TypeDef *gpio) {
+    uint32_t bsrr = gpio->BSRR;
+    uint32_t outputs = 0;
+
+    // Set wins over reset for the same pin; BSRR reads back as 0
+    gpio->ODR = ((gpio->ODR & ~(bsrr >> 16)) | bsrr) & 0xFFFFu;
+    gpio->BSRR = 0;
+
+    // Output pins read back what they drive
+    for (uint32_t pin = 0; pin < 16; pin++) {
+        if (((gpio->MODER >> (pin * 2u)) & 3u) == 1u) {
+            outputs |= 1u << pin;
+        }
+    }
+    gpio->IDR = (gpio->IDR & ~outputs) | (gpio->ODR & outputs);
+}
+
+void host_usart_tx(USART_TypeDef *usart, int busy) {
+    // TXE stays set: the bytes go straight from the queue to the shift register
+    if (busy) {
+        usart->SR &= ~USART_SR_TC;
+    } else {
+        usart->SR |= USART_SR_TC;
+    }
+}
+
+void host_usart_rx(USART_TypeDef *usart, const uint8_t *data, uint32_t len) {
+    // DMA reads every byte, clearing RXNE, and the IDLE interrupt clears IDLE: only DR keeps a trace
+    if (len > 0) {
+        usart->DR = data[len - 1];
+    }
+}
@@ -0,0 +1,164 @@
+#include "uart_driver.h"
+#include "host_port.h"
+#include "fmt.h"
+#include "FreeRTOS.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+/* uart_driver.h on a file descriptor. Writes go straight out with write(),
+ * so there is no TX queue: nothing is ever dropped for lack of room and
+ * UART_Flush() has nothing to wait for. Baud rate and flow control are only
+ * recorded (and mirrored into the USART2 model) for the commands that
+ * show them.
+ */
+
+int host_tx_fd = STDOUT_FILENO;
+
+static UART_Stats_t uart_stats;
+UART_RxProfile_t uart_rx_profile;
+static uint32_t profile_rx_base;
+static uint32_t uart_baud = 115200;
+static UART_FlowControl_t flow_mode = UART_FLOW_DEFAULT;
+
+void host_uart_received(const uint8_t *data, uint32_t len) {
+    taskENTER_CRITICAL();
+    host_usart_rx(USART2, data, len);
+    uart_stats.rx_bytes += len;
+    taskEXIT_CRITICAL();
+}
+
+size_t UART_Write(const uint8_t *data, size_t len) {
+    size_t sent = 0;
+
+    // Whole writes, so output of concurrent tasks interleaves by chunk as with the TX queue
+    taskENTER_CRITICAL();
+    host_usart_tx(USART2, 1);
+    while (sent < len) {
+        ssize_t n = write(host_tx_fd, data + sent, len - sent);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        sent += (size_t)n;
+    }
+    uart_stats.tx_bytes += sent;
+    uart_stats.tx_dropped += len - sent;
+    host_usart_tx(USART2, 0);
+    taskEXIT_CRITICAL();
+    return sent;
+}
+
+int UART_Flush(uint32_t timeout_ms) {
+    (void)timeout_ms;
+    return 0;
+}
+
+void UART_SetTxPolicy(UART_TxPolicy_t policy, uint32_t timeout_ms) {
+    (void)policy;
+    (void)timeout_ms;
+}
+
+uint32_t UART_GetTxDropped(void) {
+    return uart_stats.tx_dropped;
+}
+
+static void uart_sink(void *ctx, const char *data, size_t len) {
+    (void)ctx;
+    UART_Write((const uint8_t *)data, len);
+}
+
+void UART_Print(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    fmt_vprintf(uart_sink, NULL, format, args);
+    va_end(args);
+}
+
+// Same arithmetic as the target driver, so baud reports the BRR the board would use
+int UART_CalcBaud(uint32_t baud, UART_BaudConfig_t *cfg) {
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+    uint32_t div;
+
+    if (baud == 0) {
+        return -1;
+    }
+
+    div = (pclk + baud / 2) / baud;
+    if (div >= 16 && div <= 0xFFFF) {
+        cfg->over8 = 0;
+        cfg->brr = (uint16_t)div;
+    } else if (div >= 8 && div < 16) {
+        cfg->over8 = 1;
+        cfg->brr = (uint16_t)(((div >> 3) << 4) | (div & 0x7));
+    } else {
+        return -1;
+    }
+
+    cfg->baud = baud;
+    cfg->actual = pclk / div;
+    cfg->error_ppm = (int32_t)(((int64_t)cfg->actual - baud) * 1000000 / baud);
+    return 0;
+}
+
+int UART_SetBaud(uint32_t baud, UART_BaudConfig_t *cfg) {
+    UART_BaudConfig_t local;
+
+    if (cfg == NULL) {
+        cfg = &local;
+    }
+    if (UART_CalcBaud(baud, cfg) != 0) {
+        return -1;
+    }
+    MODIFY_REG(USART2->CR1, USART_CR1_OVER8, cfg->over8 ? USART_CR1_OVER8 : 0);
+    USART2->BRR = cfg->brr;
+    uart_baud = baud;
+    return 0;
+}
+
+uint32_t UART_GetBaud(void) {
+    return uart_baud;
+}
+
+int UART_SetFlowControl(UART_FlowControl_t mode) {
+    flow_mode = mode;
+    MODIFY_REG(USART2->CR3, USART_CR3_CTSE, mode == UART_FLOW_RTSCTS ? USART_CR3_CTSE : 0);
+    return 0;
+}
+
+UART_FlowControl_t UART_GetFlowControl(void) {
+    return flow_mode;
+}
+
+void UART_FlowUpdate(uint32_t used, uint32_t capacity) {
+    (void)used;
+    (void)capacity;
+}
+
+int UART_RxThrottled(void) {
+    return 0;
+}
+
+int UART_TxPaused(void) {
+    return 0;
+}
+
+size_t UART_RxPending(void) {
+    return 0;
+}
+
+const UART_RxProfile_t* UART_GetRxProfile(void) {
+    uart_rx_profile.rx_bytes = uart_stats.rx_bytes - profile_rx_base;
+    return &uart_rx_profile;
+}
+
+void UART_ResetRxProfile(void) {
+    profile_rx_base = uart_stats.rx_bytes;
+}
+
+const UART_Stats_t* UART_GetStats(void) {
+    return &uart_stats;
+}
@@ -0,0 +1,108 @@
+#include "fmt.h"
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* fmt_vprintf() against the C library's snprintf() for the conversions
+ * both have, across the 32/64-bit boundary where fmt_number() changes
+ * path, plus the extensions (%b, the ' flag) and the h/hh narrowing.
+ */
+
+static char out[256];
+static size_t out_len;
+static int failures;
+
+static void capture(void *ctx, const char *data, size_t len) {
+    (void)ctx;
+    if (len > sizeof(out) - 1 - out_len) {
+        len = sizeof(out) - 1 - out_len;
+    }
+    memcpy(&out[out_len], data, len);
+    out_len += len;
+    out[out_len] = '\0';
+}
+
+static const char *fmt(const char *format, ...) {
+    va_list args;
+
+    out_len = 0;
+    out[0] = '\0';
+    va_start(args, format);
+    fmt_vprintf(capture, NULL, format, args);
+    va_end(args);
+    return out;
+}
+
+#define EXPECT(want, ...) do { \
+        const char *got_ = fmt(__VA_ARGS__); \
+        if (strcmp(got_, (want)) != 0) { \
+            printf("%s:%d: %s gave \"%s\", expected \"%s\"\n", __FILE__, __LINE__, #__VA_ARGS__, got_, (want)); \
+            failures++; \
+        } \
+    } while (0)
+
+// Same format and argument through both formatters
+#define SAME(format, value) do { \
+        char want_[128]; \
+        snprintf(want_, sizeof(want_), format, value); \
+        EXPECT(want_, format, value); \
+    } while (0)
+
+static void test_against_libc(void) {
+    static const unsigned long long values[] = {
+        0, 1, 9, 10, 15, 16, 255, 4095, 65535, 999999999, 4294967295ULL,
+        4294967296ULL, 9999999999ULL, 0x0123456789ABCDEFULL, 18446744073709551615ULL,
+    };
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        unsigned long long v = values[i];
+
+        SAME("%llu", v);
+        SAME("%llx", v);
+        SAME("%#llX", v);
+        SAME("%llo", v);
+        SAME("%lld", (long long)v);
+        SAME("%024llu", v);
+        SAME("%-22llx|", v);
+        SAME("%u", (unsigned)v);
+        SAME("%08x", (unsigned)v);
+        SAME("%d", (int)v);
+        SAME("%+.12d", (int)v);
+    }
+    SAME("%d", INT_MIN);
+    SAME("%lld", LLONG_MIN);
+}
+
+static void test_extensions(void) {
+    EXPECT("10100000", "%b", 0xA0u);
+    EXPECT("00000000000000000000000010100000", "%032lb", 0xA0ul);
+    EXPECT("1111111111111111111111111111111111111111111111111111111111111111", "%llb", ~0ULL);
+    EXPECT("0b101", "%#b", 5u);
+    EXPECT("A800_04A0", "%'08lX", 0xA80004A0ul);
+    EXPECT("4,294,967,296", "%'llu", 4294967296ULL);
+    EXPECT("18,446,744,073,709,551,615", "%'llu", ~0ULL);
+}
+
+static void test_narrowing(void) {
+    EXPECT("-1", "%hd", 65535);
+    EXPECT("-128", "%hhd", 128);
+    EXPECT("65535", "%hu", -1);
+    EXPECT("ff", "%hhx", 0x1FF);
+    EXPECT("52", "%hhu", 0x1234);
+    EXPECT("4660", "%hu", 0x11234);
+}
+
+int main(void) {
+    test_against_libc();
+    test_extensions();
+    test_narrowing();
+
+    if (failures != 0) {
+        printf("test_fmt: %d failed\n", failures);
+        return 1;
+    }
+    printf("test_fmt: ok\n");
+    return 0;
+}
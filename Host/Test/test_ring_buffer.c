@@ -0,0 +1,277 @@
+#include "ring_buffer.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* test_ring_buffer [-b]
+ *
+ * Stress: a producer and a consumer thread push STRESS_BYTES of a counting
+ * sequence through a small ring, each mixing the byte, bulk and span calls
+ * with pseudo-random lengths. The consumer checks every byte, so a lost,
+ * repeated or torn byte fails the test. Two threads on a multi-core host
+ * are a harsher reordering environment than an ISR and a task on one M4.
+ * A side that finds the ring full or empty yields, so a single-CPU host
+ * still hands over promptly.
+ *
+ * -b adds a single-threaded benchmark against the RingBuffer_t this ring
+ * replaced (int count shared by both sides, % indexing), in host
+ * nanoseconds, the cycles they would be at 84 MHz (the same scaling the
+ * host dwt.h uses) and as a ratio to the old ring. Only the ratio says
+ * anything about the board, and only roughly.
+ */
+
+#define STRESS_RING     256
+#define STRESS_BYTES    (8u * 1024u * 1024u)
+
+#define BENCH_RING      256             // RX_BUFFER_SIZE
+#define BENCH_BYTES     (64u * 1024u * 1024u)
+#define BENCH_CHUNK     64
+#define BENCH_MHZ       84
+
+static uint8_t stress_storage[STRESS_RING];
+static RingBuffer_t stress_ring;
+static volatile int stress_error;
+
+// Small xorshift, one state per thread
+static uint32_t next_rand(uint32_t *state) {
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void *producer(void *arg) {
+    uint32_t seed = 0x12345678u;
+    uint32_t sent = 0;
+    uint8_t chunk[STRESS_RING];
+
+    (void)arg;
+    while (sent < STRESS_BYTES && !stress_error) {
+        uint32_t r = next_rand(&seed);
+        uint32_t want = 1 + (r >> 8) % (STRESS_RING - 1);
+        uint32_t n = 0;
+        uint8_t *span;
+
+        if (want > STRESS_BYTES - sent) {
+            want = STRESS_BYTES - sent;
+        }
+        switch (r & 3) {
+            case 0:
+                n = ring_putc(&stress_ring, (uint8_t)sent) == 0;
+                break;
+            case 1:
+                for (uint32_t i = 0; i < want; i++) {
+                    chunk[i] = (uint8_t)(sent + i);
+                }
+                n = ring_write(&stress_ring, chunk, want);
+                break;
+            default:
+                n = ring_write_span(&stress_ring, &span);
+                if (n > want) {
+                    n = want;
+                }
+                for (uint32_t i = 0; i < n; i++) {
+                    span[i] = (uint8_t)(sent + i);
+                }
+                ring_produce(&stress_ring, n);
+                break;
+        }
+        if (n == 0) {
+            sched_yield();
+        }
+        sent += n;
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    uint32_t seed = 0x9E3779B9u;
+    uint32_t received = 0;
+    uint8_t chunk[STRESS_RING];
+
+    (void)arg;
+    while (received < STRESS_BYTES && !stress_error) {
+        uint32_t r = next_rand(&seed);
+        uint32_t want = 1 + (r >> 8) % (STRESS_RING - 1);
+        uint32_t n = 0;
+        const uint8_t *span = chunk;
+        int c;
+
+        switch (r & 3) {
+            case 0:
+                c = ring_getc(&stress_ring);
+                if (c >= 0) {
+                    chunk[0] = (uint8_t)c;
+                    n = 1;
+                }
+                break;
+            case 1:
+                n = ring_read(&stress_ring, chunk, want);
+                break;
+            default:
+                n = ring_peek_span(&stress_ring, &span);
+                if (n > want) {
+                    n = want;
+                }
+                break;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (span[i] != (uint8_t)(received + i)) {
+                printf("stress: byte %u is 0x%02x, expected 0x%02x\n",
+                       (unsigned)(received + i), span[i], (uint8_t)(received + i));
+                stress_error = 1;
+                return NULL;
+            }
+        }
+        if (span != chunk) {
+            ring_commit(&stress_ring, n);
+        }
+        if (n == 0) {
+            sched_yield();
+        }
+        received += n;
+    }
+    return NULL;
+}
+
+static int stress(void) {
+    pthread_t prod;
+    pthread_t cons;
+
+    ring_init(&stress_ring, stress_storage, STRESS_RING);
+    pthread_create(&cons, NULL, consumer, NULL);
+    pthread_create(&prod, NULL, producer, NULL);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+
+    if (stress_error || ring_count(&stress_ring) != 0) {
+        printf("stress: FAILED\n");
+        return 1;
+    }
+    printf("stress: %u bytes through a %u-byte ring, ok\n", STRESS_BYTES, STRESS_RING);
+    return 0;
+}
+
+// The RingBuffer_t and buffer_putc()/buffer_getc() from shell.c before the SPSC ring
+typedef struct {
+    uint8_t buffer[BENCH_RING];
+    int head;
+    int tail;
+    int count;
+} LegacyRing_t;
+
+static void legacy_putc(LegacyRing_t *rb, uint8_t c) {
+    if (rb->count < BENCH_RING) {
+        rb->buffer[rb->head] = c;
+        rb->head = (rb->head + 1) % BENCH_RING;
+        rb->count++;
+    }
+}
+
+static uint8_t legacy_getc(LegacyRing_t *rb) {
+    uint8_t ch;
+    if (rb->count > 0) {
+        ch = rb->buffer[rb->tail];
+        rb->tail = (rb->tail + 1) % BENCH_RING;
+        rb->count--;
+        return ch;
+    }
+    return -1;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static volatile uint32_t bench_sink;
+static uint64_t bench_base_ns;
+
+// The first report is the baseline the others are compared with
+static void bench_report(const char *name, uint64_t ns) {
+    double ns_per_byte = (double)ns / BENCH_BYTES;
+
+    if (bench_base_ns == 0) {
+        bench_base_ns = ns;
+    }
+    printf("  %-28s %7.3f %9.2f %7.2fx\n", name, ns_per_byte, ns_per_byte * BENCH_MHZ / 1000.0,
+           (double)ns / (double)bench_base_ns);
+}
+
+// Fill BENCH_CHUNK bytes, drain them, repeat: the shape of the RX path
+static void bench(void) {
+    static LegacyRing_t legacy;
+    static uint8_t storage[BENCH_RING];
+    static uint8_t chunk[BENCH_CHUNK];
+    RingBuffer_t ring;
+    uint32_t sum = 0;
+    uint64_t start;
+
+    ring_init(&ring, storage, BENCH_RING);
+    printf("Ring buffer, %u bytes in %u-byte bursts, host ns and %u MHz cycles per byte:\n",
+           BENCH_BYTES, BENCH_CHUNK, BENCH_MHZ);
+    printf("  %-28s %7s %9s %8s\n", "", "ns/B", "cyc/B", "vs old");
+
+    start = now_ns();
+    for (uint32_t done = 0; done < BENCH_BYTES; done += BENCH_CHUNK) {
+        for (uint32_t i = 0; i < BENCH_CHUNK; i++) {
+            legacy_putc(&legacy, (uint8_t)i);
+        }
+        for (uint32_t i = 0; i < BENCH_CHUNK; i++) {
+            sum += legacy_getc(&legacy);
+        }
+    }
+    bench_report("RingBuffer_t putc/getc", now_ns() - start);
+
+    start = now_ns();
+    for (uint32_t done = 0; done < BENCH_BYTES; done += BENCH_CHUNK) {
+        for (uint32_t i = 0; i < BENCH_CHUNK; i++) {
+            ring_putc(&ring, (uint8_t)i);
+        }
+        for (uint32_t i = 0; i < BENCH_CHUNK; i++) {
+            sum += (uint32_t)ring_getc(&ring);
+        }
+    }
+    bench_report("ring_putc/ring_getc", now_ns() - start);
+
+    start = now_ns();
+    for (uint32_t done = 0; done < BENCH_BYTES; done += BENCH_CHUNK) {
+        ring_write(&ring, chunk, BENCH_CHUNK);
+        ring_read(&ring, chunk, BENCH_CHUNK);
+        sum += chunk[0];
+    }
+    bench_report("ring_write/ring_read", now_ns() - start);
+
+    start = now_ns();
+    for (uint32_t done = 0; done < BENCH_BYTES; done += BENCH_CHUNK) {
+        const uint8_t *span;
+        uint32_t n;
+
+        ring_write(&ring, chunk, BENCH_CHUNK);
+        while ((n = ring_peek_span(&ring, &span)) > 0) {
+            for (uint32_t i = 0; i < n; i++) {
+                sum += span[i];
+            }
+            ring_commit(&ring, n);
+        }
+    }
+    bench_report("ring_write/peek_span+commit", now_ns() - start);
+
+    bench_sink = sum;
+}
+
+int main(int argc, char **argv) {
+    int rc = stress();
+
+    if (rc == 0 && argc > 1 && strcmp(argv[1], "-b") == 0) {
+        bench();
+    }
+    return rc;
+}
@@ -0,0 +1,176 @@
+#include "shell_args.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+/* shell_args_bind() against specs whose skipped optionals keep a slot, with
+ * as many tokens as shell_tokenize() can return, and shell_args_rest()
+ * handing the rest of a line on with its quoting. argv sits in front of a
+ * guard block, so a bind that writes past SHELL_MAX_ARGS shows up without
+ * a sanitizer.
+ */
+
+#define GUARD_BYTE 0x5A
+
+static char output[512];
+static size_t output_len;
+static int failures;
+
+// The binder reports through print_shell(); keep what it says for the checks
+void print_shell(const char *format, ...) {
+    va_list args;
+
+    va_start(args, format);
+    output_len += (size_t)vsnprintf(output + output_len, sizeof(output) - output_len, format, args);
+    va_end(args);
+    if (output_len >= sizeof(output)) {
+        output_len = sizeof(output) - 1;
+    }
+}
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+static struct {
+    ShellArg_t argv[SHELL_MAX_ARGS];
+    uint8_t guard[sizeof(ShellArg_t) * SHELL_MAX_ARGS];
+} slots;
+
+static int guard_intact(void) {
+    for (size_t i = 0; i < sizeof(slots.guard); i++) {
+        if (slots.guard[i] != GUARD_BYTE) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Tokenize a copy of line and bind it to spec; returns argc or -1
+static int bind(const char *spec, const char *line) {
+    static char buf[128];
+    char *tokv[SHELL_MAX_ARGS];
+    int tokc;
+
+    snprintf(buf, sizeof(buf), "%s", line);
+    memset(slots.guard, GUARD_BYTE, sizeof(slots.guard));
+    output_len = 0;
+    output[0] = '\0';
+
+    tokc = shell_tokenize(buf, tokv, NULL, SHELL_MAX_ARGS);
+    if (tokc < 0) {
+        return tokc;
+    }
+    return shell_args_bind(tokv[0], spec, tokc, tokv, NULL, slots.argv);
+}
+
+static void test_rest_after_skipped_optional(void) {
+    const char *spec = "[-n] <ms:int> <command...>";
+    int argc;
+
+    // Skipped -n: 1 + 1 + 1 + 5 words fill argv exactly
+    argc = bind(spec, "watch 500 a b c d e");
+    CHECK(argc == SHELL_MAX_ARGS);
+    CHECK(slots.argv[1].str == NULL);
+    CHECK(slots.argv[2].num == 500);
+    CHECK(strcmp(slots.argv[7].str, "e") == 0);
+    CHECK(guard_intact());
+
+    // One word more than argv holds: refused, nothing written past the end
+    argc = bind(spec, "watch 500 a b c d e f");
+    CHECK(argc == -1);
+    CHECK(strstr(output, "too many arguments") != NULL);
+    CHECK(guard_intact());
+
+    // -n present: the slot is the token's, so the same count fits
+    argc = bind(spec, "watch -n 500 a b c d e");
+    CHECK(argc == SHELL_MAX_ARGS);
+    CHECK(slots.argv[1].index == 0);
+    CHECK(strcmp(slots.argv[3].str, "a") == 0);
+    CHECK(guard_intact());
+}
+
+static void test_skipped_optionals_without_rest(void) {
+    const char *spec = "[-a] [-b] [-c] [-d] <w:str> <x:str> <y:str> <z:str>";
+    int argc;
+
+    // Four skipped words and four values need nine slots
+    argc = bind(spec, "cmd w x y z");
+    CHECK(argc == -1);
+    CHECK(strstr(output, "too many arguments") != NULL);
+    CHECK(guard_intact());
+
+    argc = bind(spec, "cmd -a -b -c -d w x y");
+    CHECK(argc == -1);
+    CHECK(guard_intact());
+}
+
+static void test_too_many_tokens(void) {
+    CHECK(bind("<a:str>", "cmd 1 2 3 4 5 6 7 8") == SHELL_TOK_ERR_COUNT);
+    CHECK(bind("<a:str>", "cmd 1 2") == -1);
+    CHECK(strstr(output, "too many arguments") != NULL);
+    CHECK(guard_intact());
+}
+
+// Bind line as process_command() does, with the raw text of each token
+static int bind_raw(const char *spec, const char *line, char *source) {
+    static char buf[128];
+    char *tokv[SHELL_MAX_ARGS];
+    const char *rawv[SHELL_MAX_ARGS];
+    uint16_t starts[SHELL_MAX_ARGS];
+    int tokc;
+
+    snprintf(buf, sizeof(buf), "%s", line);
+    snprintf(source, 128, "%s", line);
+    tokc = shell_tokenize(buf, tokv, starts, SHELL_MAX_ARGS);
+    if (tokc < 0) {
+        return tokc;
+    }
+    for (int t = 0; t < tokc; t++) {
+        rawv[t] = &source[starts[t]];
+    }
+    return shell_args_bind(tokv[0], spec, tokc, tokv, rawv, slots.argv);
+}
+
+static void test_rest_keeps_quoting(void) {
+    char source[128];
+    char out[64];
+    int argc;
+
+    // Several words: passed on as typed, so the quoted | is not a pipe the second time
+    argc = bind_raw("<command...>", "time echo \"a|b\"  'c d'", source);
+    CHECK(shell_args_rest(argc, slots.argv, 1, out, sizeof(out)) > 0);
+    CHECK(strcmp(out, "echo \"a|b\"  'c d'") == 0);
+
+    // One quoted word is a whole command line, pipeline included
+    argc = bind_raw("<command...>", "time \"status uart2 | grep baud\"", source);
+    CHECK(shell_args_rest(argc, slots.argv, 1, out, sizeof(out)) > 0);
+    CHECK(strcmp(out, "status uart2 | grep baud") == 0);
+
+    // After a skipped optional and a number
+    argc = bind_raw("[-n] <ms:int> <command...>", "watch 500 echo \"x  y\"", source);
+    CHECK(shell_args_rest(argc, slots.argv, 3, out, sizeof(out)) > 0);
+    CHECK(strcmp(out, "echo \"x  y\"") == 0);
+
+    // Too long for out, an absent slot, or nothing left
+    CHECK(shell_args_rest(argc, slots.argv, 3, out, 8) == -1);
+    CHECK(shell_args_rest(argc, slots.argv, 1, out, sizeof(out)) == -1);
+    CHECK(shell_args_rest(argc, slots.argv, argc, out, sizeof(out)) == -1);
+}
+
+int main(void) {
+    test_rest_after_skipped_optional();
+    test_skipped_optionals_without_rest();
+    test_too_many_tokens();
+    test_rest_keeps_quoting();
+
+    if (failures != 0) {
+        printf("test_shell_args: %d failed\n", failures);
+        return 1;
+    }
+    printf("test_shell_args: ok\n");
+    return 0;
+}
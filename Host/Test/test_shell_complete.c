@@ -0,0 +1,153 @@
+#include "shell_complete.h"
+#include "shell_args.h"
+#include "shell_cmd.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+/* shell_complete_range() against a linear scan, for every prefix of every
+ * name in the peripheral and register tables plus a few that match
+ * nothing, typed in either case. A table of names that are prefixes of
+ * each other covers nodes where a name ends, and one larger than the trie
+ * pool covers the binary search fallback.
+ */
+
+static int failures;
+
+// shell_complete.c's shell side; lists are not exercised here
+void print_shell(const char *format, ...) {
+    (void)format;
+}
+
+uint16_t shell_term_width(void) {
+    return 80;
+}
+
+const ShellCommand_t* shell_cmd_find(const char *name, size_t len) {
+    (void)name;
+    (void)len;
+    return NULL;
+}
+
+const ShellCommand_t* shell_cmd_begin(void) {
+    return NULL;
+}
+
+size_t shell_cmd_count(void) {
+    return 0;
+}
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+// The first match and the number of names starting with prefix, ignoring its case
+static size_t scan(const ShellNameTable_t *table, const char *prefix, size_t len, size_t *first) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < table->count; i++) {
+        const char *name = shell_name_at(table, i);
+        size_t d = 0;
+
+        while (d < len && name[d] == tolower((unsigned char)prefix[d])) {
+            d++;
+        }
+        if (d == len) {
+            if (count++ == 0) {
+                *first = i;
+            }
+        }
+    }
+    return count;
+}
+
+static void check_prefix(const ShellNameTable_t *table, const char *prefix, size_t len) {
+    size_t want_first = 0;
+    size_t got_first = 0;
+    size_t want = scan(table, prefix, len, &want_first);
+    size_t got = shell_complete_range(table, prefix, len, &got_first);
+
+    if (got != want || (want > 0 && got_first != want_first)) {
+        printf("\"%.*s\": %zu from %zu, expected %zu from %zu\n",
+               (int)len, prefix, got, got_first, want, want_first);
+        failures++;
+    }
+}
+
+static void check_table(const ShellNameTable_t *table) {
+    static const char *const misses[] = { "q", "gpioz", "cr9", "ahb3", "uart12" };
+    char upper[32];
+
+    for (size_t i = 0; i < table->count; i++) {
+        const char *name = shell_name_at(table, i);
+        size_t n = strlen(name);
+
+        for (size_t len = 0; len <= n + 1 && len < sizeof(upper); len++) {
+            for (size_t k = 0; k < len; k++) {
+                upper[k] = (char)toupper((unsigned char)name[k]);
+            }
+            if (len > n) {
+                upper[n] = 'x';     // one past the end of the name
+            }
+            check_prefix(table, len > n ? upper : name, len);
+            check_prefix(table, upper, len);
+        }
+    }
+    for (size_t i = 0; i < sizeof(misses) / sizeof(misses[0]); i++) {
+        check_prefix(table, misses[i], strlen(misses[i]));
+    }
+}
+
+static void test_periph_tables(void) {
+    ShellNameTable_t table = { shell_periphs, sizeof(ShellPeriph_t), shell_periph_count };
+
+    check_table(&table);
+    for (size_t i = 0; i < shell_periph_count; i++) {
+        table.base = shell_periphs[i].regs;
+        table.stride = sizeof(ShellReg_t);
+        table.count = shell_periphs[i].reg_count;
+        check_table(&table);
+    }
+}
+
+static void test_nested_names(void) {
+    static const char *const names[] = { "a", "ab", "abc", "abd", "b", "ba", "bab" };
+    ShellNameTable_t table = { names, sizeof(names[0]), sizeof(names) / sizeof(names[0]) };
+    size_t first;
+
+    check_table(&table);
+    CHECK(shell_complete_range(&table, "ab", 2, &first) == 3 && first == 1);
+    CHECK(shell_complete_range(&table, "abc", 3, &first) == 1 && first == 2);
+}
+
+static void test_pool_fallback(void) {
+    // Every two-letter name: far more nodes than the pool has
+    static char storage[26 * 26][3];
+    static const char *names[26 * 26];
+    ShellNameTable_t table = { names, sizeof(names[0]), 200 };
+    size_t first;
+
+    for (size_t i = 0; i < 26 * 26; i++) {
+        storage[i][0] = (char)('a' + i / 26);
+        storage[i][1] = (char)('a' + i % 26);
+        names[i] = storage[i];
+    }
+    check_table(&table);
+    CHECK(shell_complete_range(&table, "C", 1, &first) == 26 && first == 52);
+}
+
+int main(void) {
+    test_periph_tables();
+    test_nested_names();
+    test_pool_fallback();
+
+    if (failures != 0) {
+        printf("test_shell_complete: %d failed\n", failures);
+        return 1;
+    }
+    printf("test_shell_complete: ok\n");
+    return 0;
+}
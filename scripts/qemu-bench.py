@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""Smoke benchmark for the QEMU preset image.
+
+    scripts/qemu-bench.py [-s] [-e elf] [-n runs] [command ...]
+
+Boots the firmware on an emulated netduinoplus2 with USART2 on a pipe (with
+-s, the QEMU-Semihosting image with semihosting on the pipe instead), waits
+for the first prompt, then sends each command runs times as a terminal would
+(Enter is CR) and waits for the next prompt. Reports:
+
+    boot      QEMU start to first prompt, including QEMU's own start-up
+    per cmd   Enter to prompt round trip (min, median, 95th percentile, max)
+              and the bytes the shell sent back
+
+Times are host wall clock: QEMU does not run at the board's speed, so they
+compare builds on the same machine, they do not predict the board. Any
+command that never brings the prompt back fails the run, which makes this a
+boot and smoke test as well.
+"""
+
+import argparse
+import os
+import select
+import shutil
+import statistics
+import subprocess
+import sys
+import time
+
+PROMPT = b"STM32> "
+
+DEFAULT_COMMANDS = [
+    "echo hello world",
+    "help",
+    "sysinfo",
+    "status gpioa",
+    "showreg usart2",
+    "status uart2 | grep baud",
+    "history",
+    "time showreg gpioa",
+]
+
+
+class Shell:
+    def __init__(self, argv):
+        self.proc = subprocess.Popen(argv, stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+        self.fd = self.proc.stdout.fileno()
+        self.buf = b""
+
+    def read_until(self, marker, start, timeout):
+        """Read until marker appears at or after offset start; returns the data before it."""
+        deadline = time.monotonic() + timeout
+        while True:
+            pos = self.buf.find(marker, start)
+            if pos >= 0:
+                data = self.buf[:pos]
+                self.buf = self.buf[pos + len(marker):]
+                return data
+            left = deadline - time.monotonic()
+            if left <= 0 or self.proc.poll() is not None:
+                raise TimeoutError(marker.decode(errors="replace"))
+            ready, _, _ = select.select([self.fd], [], [], left)
+            if ready:
+                chunk = os.read(self.fd, 4096)
+                if not chunk:
+                    raise EOFError("QEMU closed the serial port")
+                self.buf += chunk
+
+    def send(self, data):
+        self.proc.stdin.write(data)
+        self.proc.stdin.flush()
+
+    def close(self):
+        self.proc.kill()
+        self.proc.wait()
+
+
+def run_command(shell, command, timeout):
+    """Time one command from Enter to the prompt it leaves; returns (ms, output bytes)."""
+    shell.send(command.encode())
+    shell.read_until(command.encode(), 0, timeout)     # the echo, before the clock starts
+    start = time.monotonic()
+    shell.send(b"\r")
+    out = shell.read_until(b"\n", 0, timeout)
+    out += shell.read_until(PROMPT, 0, timeout)
+    return (time.monotonic() - start) * 1000.0, len(out)
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    parser = argparse.ArgumentParser(description="Boot the QEMU image and time shell commands")
+    parser.add_argument("-s", "--semihosting", action="store_true", help="shell over semihosting, not USART2")
+    parser.add_argument("-e", "--elf")
+    parser.add_argument("-q", "--qemu", default=os.environ.get("QEMU", "qemu-system-arm"))
+    parser.add_argument("-n", "--runs", type=int, default=20)
+    parser.add_argument("-t", "--timeout", type=float, default=10.0, help="seconds per step")
+    parser.add_argument("commands", nargs="*", default=DEFAULT_COMMANDS)
+    args = parser.parse_args()
+    if args.elf is None:
+        preset = "QEMU-Semihosting" if args.semihosting else "QEMU"
+        args.elf = os.path.join(root, "build", preset, "Stm32-shell.elf")
+
+    if not os.path.isfile(args.elf):
+        sys.exit(f"qemu-bench: {args.elf} not found, build it with the QEMU or QEMU-Semihosting preset")
+    if shutil.which(args.qemu) is None:
+        sys.exit(f"qemu-bench: {args.qemu} not found")
+
+    argv = [args.qemu, "-M", "netduinoplus2", "-display", "none", "-monitor", "none", "-serial", "null"]
+    if args.semihosting:
+        argv += ["-serial", "null", "-chardev", "stdio,id=con,signal=off",
+                 "-semihosting-config", "enable=on,target=native,chardev=con"]
+    else:
+        argv += ["-serial", "stdio"]
+    argv += ["-kernel", args.elf]
+    start = time.monotonic()
+    shell = Shell(argv)
+    try:
+        shell.read_until(PROMPT, 0, args.timeout)
+        boot_ms = (time.monotonic() - start) * 1000.0
+
+        print(f"boot to prompt {boot_ms:9.1f} ms")
+        print(f"{'command':<28} {'runs':>4} {'min ms':>8} {'med ms':>8} {'p95 ms':>8} {'max ms':>8} {'out B':>7}")
+        for command in args.commands:
+            times = []
+            out = 0
+            for _ in range(args.runs):
+                ms, out = run_command(shell, command, args.timeout)
+                times.append(ms)
+            times.sort()
+            p95 = times[min(len(times) - 1, int(len(times) * 0.95))]
+            print(f"{command[:28]:<28} {len(times):>4} {times[0]:8.2f} {statistics.median(times):8.2f} "
+                  f"{p95:8.2f} {times[-1]:8.2f} {out:>7}")
+    except (TimeoutError, EOFError) as e:
+        sys.exit(f"qemu-bench: no answer waiting for {e}")
+    finally:
+        shell.close()
+
+
+if __name__ == "__main__":
+    main()
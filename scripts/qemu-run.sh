@@ -0,0 +1,59 @@
+#!/bin/sh
+# Boot the QEMU preset image on an emulated netduinoplus2 (STM32F405).
+#
+#   scripts/qemu-run.sh [elf] [-- extra qemu arguments]
+#
+# The shell's USART2 is the board's second serial port, so the first one is
+# discarded and the second gets this terminal: Ctrl+A X quits, Ctrl+A C
+# switches to the QEMU monitor. QEMU_SERIAL moves the shell elsewhere, e.g.
+# QEMU_SERIAL=pty or QEMU_SERIAL=tcp::4444,server=on,wait=off.
+#
+# QEMU_SEMIHOSTING=1 runs the QEMU-Semihosting preset image instead: both
+# serial ports are discarded and the shell talks through semihosting on
+# this terminal, which still takes Ctrl+A X.
+set -eu
+
+QEMU=${QEMU:-qemu-system-arm}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+SERIAL=${QEMU_SERIAL:-mon:stdio}
+PRESET=QEMU
+if [ "${QEMU_SEMIHOSTING:-0}" = 1 ]; then
+    PRESET=QEMU-Semihosting
+fi
+ELF=$ROOT/build/$PRESET/Stm32-shell.elf
+
+if [ $# -gt 0 ] && [ "$1" != "--" ]; then
+    ELF=$1
+    shift
+fi
+if [ $# -gt 0 ] && [ "$1" = "--" ]; then
+    shift
+fi
+
+if [ ! -f "$ELF" ]; then
+    echo "qemu-run: $ELF not found, build it with:" >&2
+    echo "  cmake --preset $PRESET && cmake --build --preset $PRESET" >&2
+    exit 1
+fi
+
+# 8.1 is the first release whose netduinoplus2 has 4 NVIC priority bits, which
+# the FreeRTOS port asserts on (configPRIO_BITS), and USART TXE interrupts
+version=$("$QEMU" --version 2>/dev/null | sed -n 's/^QEMU emulator version \([0-9]*\.[0-9]*\).*/\1/p')
+major=${version%.*}
+minor=${version#*.}
+if [ -z "$version" ] || [ "$major" -lt 8 ] || { [ "$major" -eq 8 ] && [ "$minor" -lt 1 ]; }; then
+    echo "qemu-run: ${version:-no} $QEMU found, QEMU 8.1 or later is needed" >&2
+    exit 1
+fi
+
+if [ "$PRESET" = QEMU-Semihosting ]; then
+    exec "$QEMU" -M netduinoplus2 -display none -monitor none \
+        -serial null -serial null \
+        -chardev stdio,id=con,mux=on,signal=off -mon chardev=con \
+        -semihosting-config enable=on,target=native,chardev=con \
+        -kernel "$ELF" "$@"
+fi
+
+exec "$QEMU" -M netduinoplus2 -display none -monitor none \
+    -serial null -serial "$SERIAL" \
+    -kernel "$ELF" "$@"